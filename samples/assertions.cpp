@@ -1,4 +1,7 @@
+#include <cmath>
 #include <cstring>
+#include <string>
+#include <vector>
 #include <thread>
 #include "../src/enki.h"
 
@@ -8,11 +11,15 @@ class AssertTestCase : public TestCase<AssertTestCase> {
   public:
     AssertTestCase() {
       add(&AssertTestCase::test_assert, "Assert::assert()");
+      add(&AssertTestCase::test_assert_message_fail, "Assert::assert() with a lazy message fail");
       add(&AssertTestCase::test_assert_exception, "Assert::assert_exception()");
       add(&AssertTestCase::test_assert_array_equals_pass, "Assert::assert_array_equals() pass");
       add(&AssertTestCase::test_assert_array_equals_fail, "Assert::assert_array_equals() fail");
+      add(&AssertTestCase::test_assert_container_equals_fail, "Assert::assert_container_equals() fail");
       add(&AssertTestCase::test_assert_array_subdomain_pass, "Assert::assert_array_subdomain() pass");
       add(&AssertTestCase::test_assert_array_subdomain_fail, "Assert::assert_array_subdomain() fail");
+      add(&AssertTestCase::test_assert_near_pass, "Assert::assert_near() pass");
+      add(&AssertTestCase::test_assert_array_near_fail, "Assert::assert_array_near() fail");
       add(&AssertTestCase::test_wait_1s, "Timing test, 666ms ");
     }
 
@@ -20,6 +27,14 @@ class AssertTestCase : public TestCase<AssertTestCase> {
       Assert::assert(true == !false);
     }
 
+    void test_assert_message_fail() {
+      std::vector<int> v = {3, 1, 4, 1, 5, 9, 2, 6};
+
+      /* The message is only built for the failing element */
+      for(size_t t = 1; t < v.size(); t++)
+        Assert::assert(v[t] - v[t - 1] < 4, [&] (std::ostream& os) { os << "v[" << t << "] = " << v[t] << " follows " << v[t - 1]; });
+    }
+
     void test_assert_exception() {
       auto f = [] { throw std::exception(); };
 
@@ -40,6 +55,13 @@ class AssertTestCase : public TestCase<AssertTestCase> {
       Assert::assert_array_equals<int>(a, 5, b, 5);
     }
 
+    void test_assert_container_equals_fail() {
+      std::vector<std::string> a = {"alpha", "beta", "gamma", "delta", "epsilon"};
+      std::vector<std::string> b = {"alpha", "gamma", "delta", "zeta", "epsilon"};
+
+      Assert::assert_container_equals(a, b);
+    }
+
     void test_assert_array_subdomain_pass() {
       char arr[] = "abcdefghijklmnopqrstuvwxyz";
 
@@ -52,6 +74,23 @@ class AssertTestCase : public TestCase<AssertTestCase> {
       Assert::assert_array_subdomain(arr, strlen(arr), 'a', 'z');
     }
 
+    void test_assert_near_pass() {
+      Assert::assert_near(0.1 + 0.2, 0.3, Tolerance(0.0, 0.0, 1));
+      Assert::assert_near(1e-12, 0.0, Tolerance(1e-9));
+    }
+
+    void test_assert_array_near_fail() {
+      std::vector<float> a(100000), b;
+
+      for(size_t t = 0; t < a.size(); t++)
+        a[t] = std::sqrt(float(t));
+
+      b = a;
+      b[4242] += 0.01f;
+
+      Assert::assert_array_near(a.data(), a.size(), b.data(), b.size(), Tolerance(0.0, 1e-6));
+    }
+
     void test_wait_1s() {
       using std::chrono::duration;
       using std::chrono::milliseconds;
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <numeric>
+#include <set>
+#include <vector>
+#include "../src/enki.h"
+
+using namespace enki;
+
+class BenchmarkTestCase : public TestCase<BenchmarkTestCase> {
+  public:
+    BenchmarkTestCase(): shared_counter(0) {
+      BenchmarkConfig config;
+
+      config.min_time = 0.1;
+
+      /* Report the steady state, the very first iteration and 20 iterations on cold caches */
+      config.warmup_iterations = 100;
+      config.cold_iterations = 20;
+
+      add_benchmark(&BenchmarkTestCase::bench_sum, "Sum 1000 integers", config);
+      add_benchmark(&BenchmarkTestCase::bench_sort, "Sort 1000 integers", config);
+
+      /* One instance per size, fitted to a complexity class */
+      config.min_time = 0.02;
+      config.cold_iterations = 0;
+      config.complexity = true;
+
+      add_benchmark(&BenchmarkTestCase::bench_set_insert, "Set insert", {geometric_range(64, 65536, 4)}, config);
+      add(&BenchmarkTestCase::test_find_complexity, "Linear search is O(n)");
+      add(&BenchmarkTestCase::test_lookup_latency, "Set lookup tail latency");
+
+      /* A performance contract, failing like a functional test if broken */
+      add(&BenchmarkTestCase::test_binary_search, "Binary search beats linear search", std::chrono::seconds(2));
+
+      /* One instance per number of threads, all incrementing the same counter */
+      config = BenchmarkConfig();
+      config.min_time = 0.05;
+      config.threads = geometric_range(1u, 5u, 2u);
+
+      add_benchmark(&BenchmarkTestCase::bench_shared_counter, "Shared counter", config);
+    }
+
+    virtual void setup() {
+      input.resize(1000);
+
+      for(size_t t = 0; t < input.size(); t++)
+        input[t] = static_cast<int>((t * 7919) % 1000);
+    }
+
+    void bench_sum(Benchmark& state) {
+      while(state.keep_running()) {
+        int sum = std::accumulate(input.begin(), input.end(), 0);
+
+        /* Without this, the optimizer is free to skip the whole loop */
+        do_not_optimize(sum);
+      }
+
+      state.set_bytes_processed(double(state.get_iterations()) * input.size() * sizeof(int));
+      state.set_items_processed(double(state.get_iterations()) * input.size());
+    }
+
+    void bench_sort(Benchmark& state) {
+      std::vector<int> v;
+
+      while(state.keep_running()) {
+        v = input;
+        std::sort(v.begin(), v.end());
+        clobber_memory();
+      }
+
+      Assert::assert(std::is_sorted(v.begin(), v.end()));
+      state.set_counter("sorts", double(state.get_iterations()), CounterKind::RATE);
+      state.set_counter("elements", double(v.size()), CounterKind::TOTAL);
+    }
+
+    void bench_set_insert(Benchmark& state) {
+      while(state.keep_running()) {
+        std::set<long long> s;
+
+        for(long long t = 0; t < state.range(); t++)
+          s.insert(t * 7919 % state.range());
+
+        do_not_optimize(s);
+      }
+    }
+
+    void test_find_complexity() {
+      BenchmarkConfig config;
+
+      config.min_time = 0.01;
+
+      Assert::assert_complexity(Complexity::O_N, geometric_range(1024LL, 1LL << 16, 2LL), [] (Benchmark& state) {
+        std::vector<int> v(state.range(), 0);
+
+        while(state.keep_running()) {
+          do_not_optimize(v.data());
+          do_not_optimize(std::find(v.begin(), v.end(), 1));
+        }
+      }, config);
+    }
+
+    void test_lookup_latency() {
+      std::set<int> s(input.begin(), input.end());
+      LatencyHistogram& latency = this->latency("lookup");
+
+      for(int t = 0; t < 100000; t++) {
+        Timer::Ticks t1 = Timer::start();
+
+        do_not_optimize(s.find(t % 2000));
+        latency.record(t1, Timer::stop());
+      }
+
+      /* The tail, not the mean, is what the callers notice */
+      Assert::assert_percentile_below("lookup", 99.0, 100000);
+    }
+
+    void test_binary_search() {
+      std::vector<int> sorted(input);
+
+      std::sort(sorted.begin(), sorted.end());
+
+      Assert::assert_faster_than([&] {
+        do_not_optimize(std::lower_bound(sorted.begin(), sorted.end(), 997));
+      }, [&] {
+        do_not_optimize(std::find(sorted.begin(), sorted.end(), 997));
+      });
+    }
+
+    void bench_shared_counter(Benchmark& state) {
+      while(state.keep_running())
+        shared_counter.fetch_add(1, std::memory_order_relaxed);
+
+      state.set_items_processed(double(state.get_iterations()));
+    }
+
+  private:
+    std::vector<int> input;
+    std::atomic<long> shared_counter;
+};
+
+int main(int argc, char** argv) {
+  BenchmarkTestCase tcase;
+  ConsoleResultExporter<BenchmarkTestCase> exp(true);
+
+  /* With --strict, timings from a noisy machine are not worth keeping: do not even take them */
+  for(int t = 1; t < argc; t++)
+    if(!std::strcmp(argv[t], "--strict"))
+      tcase.set_strict_preflight(true);
+    else
+      tcase.set_filter(TestFilter(argv[t]));
+
+  int ret = tcase.run()? 0: 1;
+
+  exp.export_results(tcase);
+
+  return ret;
+}
@@ -0,0 +1,50 @@
+#include <string>
+#include "../src/enki.h"
+
+using namespace enki;
+
+/*
+ * Build with coverage feedback to let the fuzzer explore the parser:
+ *   g++ -std=c++0x -pthread -fsanitize-coverage=trace-pc -DENKI_FUZZ_COVERAGE -I../src/ fuzzing.cpp
+ * Run with --fuzz to fuzz, without arguments to replay the corpus.
+ */
+class FuzzTestCase : public TestCase<FuzzTestCase> {
+  public:
+    FuzzTestCase() {
+      FuzzConfig config;
+
+      config.corpus_dir = "corpus";
+      config.runs = 20000;
+      config.max_len = 64;
+
+      add_fuzz(&FuzzTestCase::test_parse_header, "Header parser", config);
+    }
+
+    void test_parse_header(const std::uint8_t* data, size_t size) {
+      /* A toy parser: "HDR" followed by a length byte and a payload */
+      if(size < 4 || data[0] != 'H')
+        return;
+
+      if(data[1] != 'D')
+        return;
+
+      if(data[2] != 'R')
+        return;
+
+      if(data[3] > size - 4)
+        fail("Payload length exceeds the input size");
+    }
+};
+
+int main(int argc, char** argv) {
+  FuzzTestCase tcase;
+  ConsoleResultExporter<FuzzTestCase> exp(true);
+
+  tcase.set_fuzz_mode(argc > 1 && std::string(argv[1]) == "--fuzz");
+
+  int ret = tcase.run()? 0: 1;
+
+  exp.export_results(tcase);
+
+  return ret;
+}
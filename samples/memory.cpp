@@ -0,0 +1,61 @@
+/* Count the allocations of each test; define this in one translation unit only */
+#define ENKI_TRACK_ALLOCATIONS
+
+#include <vector>
+#include "../src/enki.h"
+
+using namespace enki;
+
+class MemoryTestCase : public TestCase<MemoryTestCase> {
+  public:
+    MemoryTestCase() {
+      add(&MemoryTestCase::test_small, "Small buffer");
+      add(&MemoryTestCase::test_large, "Large buffer (fails)");
+      add(&MemoryTestCase::test_leak, "Leaking buffer");
+    }
+
+    void test_small() {
+      Assert::assert_max_memory(4096, [] () {
+        std::vector<char> buffer(1024, 'x');
+
+        do_not_optimize(buffer.data());
+      });
+    }
+
+    void test_large() {
+      Assert::assert_max_memory(1 << 20, [] () {
+        std::vector<char> buffer(8 << 20, 'x');
+
+        do_not_optimize(buffer.data());
+      });
+    }
+
+    void test_leak() {
+      leaked.push_back(new char[1 << 16]);
+    }
+
+    virtual void cleanup() {
+      for(size_t t = 0; t < leaked.size(); t++)
+        delete[] leaked[t];
+    }
+
+  private:
+    std::vector<char*> leaked;
+};
+
+int main(int argc, char** argv) {
+  MemoryTestCase tcase;
+  ConsoleResultExporter<MemoryTestCase> exp(true);
+
+  /* Run each test alone on its own fixture for exact RSS figures */
+  tcase.set_isolation(Isolation::PER_TEST);
+
+  if(argc > 1)
+    tcase.set_filter(TestFilter(argv[1]));
+
+  int ret = tcase.run()? 0: 1;
+
+  exp.export_results(tcase);
+
+  return ret;
+}
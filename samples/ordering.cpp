@@ -0,0 +1,70 @@
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "../src/enki.h"
+
+using namespace enki;
+
+/*
+ * The fixture is shared by all the tests, so a test that leaves data behind
+ * can break the tests running after it.
+ */
+class OrderingTestCase : public TestCase<OrderingTestCase> {
+  public:
+    OrderingTestCase() {
+      add(&OrderingTestCase::test_append, "Append an item");
+      add(&OrderingTestCase::test_size, "Count the items");
+      add(&OrderingTestCase::test_clear, "Clear the items");
+      add(&OrderingTestCase::test_empty, "Starts empty");
+      add(&OrderingTestCase::test_stateless, "Stateless");
+    }
+
+    void test_append() {
+      items.push_back(1);
+      Assert::assert(!items.empty());
+    }
+
+    void test_size() {
+      Assert::assert(items.size() < 10);
+    }
+
+    void test_clear() {
+      items.clear();
+      Assert::assert(items.empty());
+    }
+
+    void test_empty() {
+      Assert::assert(items.empty()); /* Fails if run after test_append and before test_clear */
+    }
+
+    void test_stateless() {
+    }
+
+  private:
+    std::vector<int> items;
+};
+
+int main(int argc, char** argv) {
+  OrderingTestCase tcase;
+  ConsoleResultExporter<OrderingTestCase> exp;
+
+  /* Replay a previous order by passing its seed */
+  tcase.set_shuffle(true, argc > 1? std::strtoull(argv[1], nullptr, 0): 0);
+
+  int ret = tcase.run()? 0: 1;
+
+  exp.export_results(tcase);
+
+  for(auto it = tcase.get_schedule().begin(); it != tcase.get_schedule().end(); it++) {
+    if(!(*it)->passed) {
+      std::vector<OrderingTestCase::TestData*> culprits = tcase.bisect(**it);
+
+      std::cout << (*it)->full_name() << " fails after:" << std::endl;
+
+      for(auto c = culprits.begin(); c != culprits.end(); c++)
+        std::cout << "  " << (*c)->full_name() << std::endl;
+    }
+  }
+
+  return ret;
+}
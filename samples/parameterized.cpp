@@ -0,0 +1,42 @@
+#include <string>
+#include "../src/enki.h"
+
+using namespace enki;
+
+class ParameterizedTestCase : public TestCase<ParameterizedTestCase> {
+  public:
+    /* Typed test, run once for each type given to add_typed() */
+    template<typename U> struct SignednessTest {
+      static void run(ParameterizedTestCase&) {
+        Assert::assert(U(-1) < U(0));
+      }
+    };
+
+    ParameterizedTestCase() {
+      add(&ParameterizedTestCase::test_even, "Even numbers", range(0, 100, 2));
+      add(&ParameterizedTestCase::test_length, "String length", std::vector<std::string>{"a", "ab", "abc", ""},
+        [] (const char* name, const std::string& param, size_t) { return std::string(name) + " \"" + param + "\""; });
+      add_typed<SignednessTest, int, long, float, unsigned>("Signedness");
+    }
+
+    void test_even(const int& n) {
+      Assert::assert(n % 2 == 0);
+    }
+
+    void test_length(const std::string& s) {
+      Assert::assert(!s.empty());
+    }
+};
+
+int main(int argc, char** argv) {
+  ParameterizedTestCase tcase;
+  ConsoleResultExporter<ParameterizedTestCase> exp;
+
+  tcase.set_filter(TestFilter(argc > 1? argv[1]: "Even numbers/1*:String length*:Signedness*"));
+
+  int ret = tcase.run()? 0: 1;
+
+  exp.export_results(tcase);
+
+  return ret;
+}
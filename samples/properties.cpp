@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "../src/enki.h"
+
+using namespace enki;
+
+class PropertyTestCase : public TestCase<PropertyTestCase> {
+  public:
+    PropertyTestCase() {
+      add(&PropertyTestCase::test_reverse_twice, "Reversing twice is identity");
+      add(&PropertyTestCase::test_sort_idempotent, "Sorting is idempotent");
+      add(&PropertyTestCase::test_sum_bounded, "Sum is bounded (fails)");
+      add(&PropertyTestCase::test_no_digits, "Strings have no digits (fails)");
+    }
+
+    void test_reverse_twice() {
+      Assert::assert_property<std::vector<int>>([] (const std::vector<int>& v) {
+        std::vector<int> r(v.rbegin(), v.rend());
+
+        std::reverse(r.begin(), r.end());
+
+        return r == v;
+      });
+    }
+
+    void test_sort_idempotent() {
+      PropertyConfig config;
+
+      config.cases = 1000;
+
+      Assert::assert_property(gen::Vector<gen::Floating<double>>(), [] (const std::vector<double>& v) {
+        std::vector<double> a(v), b;
+
+        std::sort(a.begin(), a.end());
+        b = a;
+        std::sort(b.begin(), b.end());
+
+        Assert::assert(a == b);
+      }, config);
+    }
+
+    void test_sum_bounded() {
+      Assert::assert_property(gen::Vector<gen::Integral<int>>(gen::Integral<int>(0, 100)), [] (const std::vector<int>& v) {
+        int sum = 0;
+
+        for(size_t t = 0; t < v.size(); t++)
+          sum += v[t];
+
+        return sum < 500;
+      });
+    }
+
+    void test_no_digits() {
+      Assert::assert_property(gen::String(), [] (const std::string& s) {
+        Assert::assert(std::find_if(s.begin(), s.end(), [] (char c) { return c >= '0' && c <= '9'; }) == s.end());
+      });
+    }
+};
+
+int main(int argc, char** argv) {
+  PropertyTestCase tcase;
+  ConsoleResultExporter<PropertyTestCase> exp(true);
+
+  if(argc > 1)
+    tcase.set_filter(TestFilter(argv[1]));
+
+  int ret = tcase.run()? 0: 1;
+
+  exp.export_results(tcase);
+
+  return ret;
+}
@@ -0,0 +1,43 @@
+#include <atomic>
+#include <cstdlib>
+#include "../src/enki.h"
+
+using namespace enki;
+
+class RepeatTestCase : public TestCase<RepeatTestCase> {
+  public:
+    RepeatTestCase() {
+      add(&RepeatTestCase::test_stable, "Stable");
+      add(&RepeatTestCase::test_flaky, "Flaky");
+    }
+
+    void test_stable() {
+      Assert::assert(1 + 1 == 2);
+    }
+
+    void test_flaky() {
+      static std::atomic<unsigned> calls(0);
+
+      /* Fails one run out of ten */
+      if(++calls % 10 == 0)
+        fail("Unlucky run");
+    }
+};
+
+int main(int argc, char** argv) {
+  RepeatTestCase tcase;
+  ConsoleResultExporter<RepeatTestCase> exp(true);
+
+  /* Each run gets its own fixture, so the runs of a test can be spread over the cores */
+  tcase.set_isolation(Isolation::PER_TEST);
+  tcase.set_workers(0);
+  tcase.set_placement(Placement::SPREAD);
+  tcase.set_warmup(2);
+  tcase.set_repeat(argc > 1? std::strtoul(argv[1], nullptr, 0): 100);
+
+  int ret = tcase.run()? 0: 1;
+
+  exp.export_results(tcase);
+
+  return ret;
+}
@@ -7,9 +7,9 @@ using namespace enki;
 class SkeletonTestCase : public TestCase<SkeletonTestCase> {
   public:
     SkeletonTestCase(): TestCase() {
-      add(&SkeletonTestCase::testPass, "Test pass 1");
-      add(&SkeletonTestCase::testFailed, "Test fail 1");
-      add(&SkeletonTestCase::testPass, "Test pass 2");
+      add(&SkeletonTestCase::testPass, "Test pass 1", "pass");
+      add(&SkeletonTestCase::testFailed, "Test fail 1", "fail");
+      add(&SkeletonTestCase::testPass, "Test pass 2", "pass");
       add(&SkeletonTestCase::testEmpty, "Test empty");
     }
 
@@ -29,6 +29,10 @@ int main(int argc, char** argv) {
   SkeletonTestCase tcase;
   ConsoleResultExporter<SkeletonTestCase> cexp;
 
+  /* Select the tests to run, e.g. "Test pass*" or "*-@fail" */
+  if(argc > 1)
+    tcase.set_filter(TestFilter(argv[1]));
+
   tcase.run();
   cexp.export_results(tcase);
 }
@@ -35,6 +35,79 @@
 #include <exception>
 #include <functional>
 #include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <typeinfo>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <random>
+#include <sstream>
+#include <limits>
+#include <utility>
+#include <cmath>
+#include <cstdio>
+#include <cerrno>
+#include <deque>
+#include <new>
+#include <condition_variable>
+
+#ifdef ENKI_REGEX
+  #include <regex>
+#endif /* ENKI_REGEX */
+
+#if defined(__unix__) || defined(__APPLE__)
+  #define ENKI_POSIX
+  #include <sys/types.h>
+  #include <sys/stat.h>
+  #include <sys/mman.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <dirent.h>
+  #include <signal.h>
+  #include <sys/time.h>
+  #include <sys/resource.h>
+#endif /* __unix__ || __APPLE__ */
+
+#if defined(__linux__)
+  #include <pthread.h>
+  #include <sched.h>
+  #include <sys/syscall.h>
+#endif /* __linux__ */
+
+#if defined(__GNUG__)
+  #include <cxxabi.h>
+  #include <cstdlib>
+#endif /* __GNUG__ */
+
+#if defined(__GNUC__) && defined(__x86_64__)
+  #include <cpuid.h>
+#endif /* __GNUC__ && __x86_64__ */
+
+/* Excludes a function from sanitizer coverage instrumentation */
+#if defined(__clang__)
+  #define ENKI_NO_COVERAGE __attribute__((no_sanitize("coverage")))
+#elif defined(__GNUC__) && __GNUC__ >= 12
+  #define ENKI_NO_COVERAGE __attribute__((no_sanitize_coverage))
+#else
+  #define ENKI_NO_COVERAGE
+#endif /* __clang__ */
+
+/* Source location of the caller, when used in a default argument */
+#if defined(__clang__)
+  #if __has_builtin(__builtin_FILE) && __has_builtin(__builtin_LINE) && __has_builtin(__builtin_FUNCTION)
+    #define ENKI_CALLER_LOCATION
+  #endif /* __has_builtin(__builtin_FILE) */
+#elif defined(__GNUC__) || (defined(_MSC_VER) && _MSC_VER >= 1926)
+  #define ENKI_CALLER_LOCATION
+#endif /* __clang__ */
 
 #if !defined(ENKI_STYLE_NOCOLORS) && !defined(__WIN32)
   #define ENKI_STYLE_PASSED "\33[32m" 
@@ -57,185 +130,7511 @@ namespace enki {
   template<typename T> class ResultExporter;
 
   /*
-   * Exception thrown to indicate that a test has failed.
+   * Location in the source code, such as that of a failed assertion.
    */
-  class TestFailedException : public std::exception {
-    public:
-      TestFailedException() noexcept: exception() {}
-      virtual const char* what() const noexcept { return "Test failed"; }
+  struct SourceLocation {
+    const char* file; /* File name, nullptr if unknown */
+    unsigned line; /* Line number, 0 if unknown */
+    const char* function; /* Function name, nullptr if unknown */
+
+    /*
+     * Initializes a new location.
+     *
+     * file: The file name, nullptr if unknown
+     * line: The line number, 0 if unknown
+     * function: The function name, nullptr if unknown
+     */
+    explicit SourceLocation(const char* file = nullptr, unsigned line = 0, const char* function = nullptr) noexcept: file(file), line(line), function(function) {}
+
+    /*
+     * Returns the location of the caller. Used as a default argument, it is
+     * the location of the call to the function taking the argument. Without
+     * compiler support (see ENKI_CALLER_LOCATION), the location is unknown.
+     *
+     * Return value: The location
+     */
+#ifdef ENKI_CALLER_LOCATION
+    static SourceLocation current(const char* file = __builtin_FILE(), unsigned line = __builtin_LINE(), const char* function = __builtin_FUNCTION()) noexcept {
+      return SourceLocation(file, line, function);
+    }
+#else
+    static SourceLocation current() noexcept { return SourceLocation(); }
+#endif /* ENKI_CALLER_LOCATION */
+
+    /*
+     * Checks whether the location is known.
+     *
+     * Return value: true if the file is known, false if not
+     */
+    bool known() const noexcept { return file != nullptr; }
+
+    /*
+     * Formats the location as "file:line".
+     *
+     * Return value: The formatted location, empty if unknown
+     */
+    std::string str() const { return file? std::string(file) + ":" + std::to_string(line): std::string(); }
   };
 
   /*
-   * Exception thrown to indicate that a test has passed.
+   * Details of a test failure.
    */
-  class TestPassedException : public std::exception {
-    public:
-      TestPassedException() noexcept: exception() {}
-      virtual const char* what() const noexcept { return "Test passed"; }
+  struct Failure {
+    std::string message; /* Failure message */
+    SourceLocation location; /* Location of the failed assertion, unknown if not captured */
+    long long mismatch = -1; /* Index of the first mismatching element of the compared sequences, -1 if none */
+    std::string diff; /* Diff of the compared sequences, empty if none */
+
+    /*
+     * Initializes new failure details.
+     *
+     * message: The failure message
+     * location: The location of the failed assertion
+     */
+    explicit Failure(const std::string& message = std::string(), const SourceLocation& location = SourceLocation()): message(message), location(location) {}
   };
 
   /*
-   * This class provides facilities for assertions.
-   *
-   * All the methods inside this class do not return any value and
-   * fail the test if the asserted condition is not met.
+   * Exception thrown to indicate that a test has failed.
    */
-  class Assert {
+  class TestFailedException : public std::exception {
     public:
+      TestFailedException() noexcept: exception() {}
+
       /*
-       * Asserts that a condition is true.
+       * Initializes a new exception carrying a failure message.
        *
-       * condition: The condition
+       * message: The failure message
        */
-      static void assert(bool condition) { if(!condition) throw TestFailedException(); }
+      explicit TestFailedException(const std::string& message): exception(), details(std::make_shared<Failure>(message)) {}
 
       /*
-       * Asserts that no exception is thrown.
+       * Initializes a new exception carrying the details of a failure.
        *
-       * func: The function to test
+       * failure: The failure details
        */
-      static void assert_exception(typename std::function<void(void)> func) { try { func(); } catch(...) { throw TestFailedException(); } }
+      explicit TestFailedException(const Failure& failure): exception(), details(std::make_shared<Failure>(failure)) {}
+
+      virtual const char* what() const noexcept { return details && !details->message.empty()? details->message.c_str(): "Test failed"; }
 
       /*
-       * Asserts that two arrays are equivalent. Two arrays are
-       * said to be equivalent when they have the same elements
-       * in the same order.
+       * Returns the failure message.
        *
-       * a: The first array
-       * b: The second array
-       * len_a: The length of a
-       * len_b: The length of b
+       * Return value: The failure message, or an empty string if none was given
+       */
+      std::string message() const { return details? details->message: std::string(); }
+
+      /*
+       * Returns the details of the failure.
        *
-       * T: The domain type of both arrays
+       * Return value: The failure details, empty if none were given
        */
-      template<typename T> static void assert_array_equals(const T* a, size_t len_a, const T* b, size_t len_b) {
-        assert(len_a == len_b);
-        
-        for(size_t t = 0; t < len_a; t++)
-          if(a[t] != b[t])
-            throw TestFailedException();
+      Failure failure() const { return details? *details: Failure(); }
+
+    private:
+      std::shared_ptr<const Failure> details; /* Failure details, shared so that copies do not throw */
+  };
+
+  /*
+   * Exception thrown to indicate that a test has passed.
+   */
+  class TestPassedException : public std::exception {
+    public:
+      TestPassedException() noexcept: exception() {}
+      virtual const char* what() const noexcept { return "Test passed"; }
+  };
+
+  /*
+   * Implementation details.
+   */
+  namespace detail {
+    /*
+     * Returns the human readable name of a type.
+     *
+     * type: The type
+     *
+     * Return value: The demangled type name where supported, the implementation defined name elsewhere
+     */
+    inline std::string type_name(const std::type_info& type) {
+#if defined(__GNUG__)
+      int status = 0;
+      char* demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+
+      if(demangled) {
+        std::string name(demangled);
+
+        std::free(demangled);
+
+        return name;
+      }
+#endif /* __GNUG__ */
+      return type.name();
+    }
+
+    /*
+     * Returns the number of hardware threads.
+     *
+     * Return value: The number of hardware threads, at least 1
+     */
+    inline unsigned hardware_workers() {
+      unsigned n = std::thread::hardware_concurrency();
+
+      return n? n: 1;
+    }
+
+    /*
+     * Calls a function for each index in [0, count), distributing the indices
+     * over a set of worker threads. The calling thread acts as the first worker.
+     *
+     * If a call throws, no further index is started and the first exception
+     * is rethrown once all the workers have stopped.
+     *
+     * count: The number of indices
+     * workers: The number of workers, 0 for one per hardware thread
+     * func: The function, called as func(index, worker)
+     */
+    template<typename F> void parallel_for(size_t count, unsigned workers, F func) {
+      if(!workers)
+        workers = hardware_workers();
+
+      if(workers > count)
+        workers = static_cast<unsigned>(count);
+
+      if(workers <= 1) {
+        for(size_t t = 0; t < count; t++)
+          func(t, 0u);
+
+        return;
+      }
+
+      std::atomic<size_t> next(0);
+      std::exception_ptr error;
+      std::mutex error_mutex;
+      std::vector<std::thread> threads;
+      auto worker = [&] (unsigned w) {
+        for(size_t t = next++; t < count; t = next++) {
+          try {
+            func(t, w);
+          } catch(...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+
+            if(!error)
+              error = std::current_exception();
+
+            next = count;
+          }
+        }
+      };
+
+      for(unsigned w = 1; w < workers; w++)
+        threads.push_back(std::thread(worker, w));
+
+      worker(0);
+
+      for(std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); it++)
+        it->join();
+
+      if(error)
+        std::rethrow_exception(error);
+    }
+
+    /*
+     * Returns a seed for random generation. The ENKI_SEED environment variable,
+     * when set, overrides the seed to reproduce a previous run.
+     *
+     * Return value: The seed
+     */
+    inline std::uint64_t random_seed() {
+      const char* env = std::getenv("ENKI_SEED");
+
+      if(env && *env)
+        return std::strtoull(env, nullptr, 0);
+
+      std::random_device rd;
+
+      return (std::uint64_t(rd()) << 32) ^ rd() ^ std::uint64_t(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+    }
+
+    /*
+     * Derives a well mixed value from a seed and an index (SplitMix64).
+     *
+     * seed: The seed
+     * index: The index
+     *
+     * Return value: The derived value
+     */
+    inline std::uint64_t mix_seed(std::uint64_t seed, std::uint64_t index) {
+      std::uint64_t z = seed + (index + 1) * 0x9e3779b97f4a7c15ULL;
+
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+      return z ^ (z >> 31);
+    }
+
+    /* Checks whether a value can be written to an output stream */
+    template<typename V> class is_streamable {
+      template<typename U> static auto test(int) -> decltype(std::declval<std::ostream&>() << std::declval<const U&>(), std::true_type());
+      template<typename> static std::false_type test(...);
+
+      public:
+        static const bool value = decltype(test<V>(0))::value;
+    };
+
+    template<typename V> void print(std::ostream& os, const V& value);
+
+    template<typename V> void print(std::ostream& os, const V& value, std::true_type) { os << value; }
+    template<typename V> void print(std::ostream& os, const V&, std::false_type) { os << "<" << type_name(typeid(V)) << ">"; }
+
+    inline void print(std::ostream& os, const std::string& value) { os << '"' << value << '"'; }
+    inline void print(std::ostream& os, char value) { os << '\'' << value << '\''; }
+
+    template<typename A, typename B> void print(std::ostream& os, const std::pair<A, B>& value) {
+      os << "(";
+      print(os, value.first);
+      os << ", ";
+      print(os, value.second);
+      os << ")";
+    }
+
+    template<typename E> void print(std::ostream& os, const std::vector<E>& value) {
+      os << "[";
+
+      for(size_t t = 0; t < value.size(); t++) {
+        if(t)
+          os << ", ";
+
+        print(os, value[t]);
+      }
+
+      os << "]";
+    }
+
+    /*
+     * Writes a value to a stream in a human readable form. Values that cannot be
+     * written to a stream are represented by their type name.
+     *
+     * os: The output stream
+     * value: The value
+     */
+    template<typename V> void print(std::ostream& os, const V& value) { print(os, value, std::integral_constant<bool, is_streamable<V>::value>()); }
+
+    /*
+     * Converts a value to a human readable string.
+     *
+     * value: The value
+     *
+     * Return value: The string
+     */
+    template<typename V> std::string to_string(const V& value) {
+      std::ostringstream os;
+
+      print(os, value);
+
+      return os.str();
+    }
+
+    /*
+     * Formats a window of a byte buffer as a hex dump, 16 bytes per line,
+     * optionally marking the line holding a given offset with '>'.
+     *
+     * data: The buffer
+     * size: The buffer size
+     * offset: The offset of the first byte to dump
+     * count: The maximum number of bytes to dump
+     * mark: The offset to mark, SIZE_MAX for no mark
+     *
+     * Return value: The hex dump
+     */
+    inline std::string hexdump(const std::uint8_t* data, size_t size, size_t offset = 0, size_t count = 256, size_t mark = SIZE_MAX) {
+      static const char digits[] = "0123456789abcdef";
+      std::string out;
+      size_t end = offset + std::min(count, size - std::min(offset, size));
+
+      for(size_t line = offset - offset % 16; line < end; line += 16) {
+        char addr[24];
+
+        if(mark != SIZE_MAX)
+          out += mark >= line && mark < line + 16? "> ": "  ";
+
+        std::snprintf(addr, sizeof(addr), "%08zx  ", line);
+        out += addr;
+
+        for(size_t t = line; t < line + 16; t++) {
+          if(t >= offset && t < end) {
+            out += digits[data[t] >> 4];
+            out += digits[data[t] & 15];
+            out += ' ';
+          } else
+            out += "   ";
+        }
+
+        out += " |";
+
+        for(size_t t = std::max(line, offset); t < std::min(line + 16, end); t++)
+          out += data[t] >= 0x20 && data[t] < 0x7f? static_cast<char>(data[t]): '.';
+
+        out += "|\n";
+      }
+
+      if(end < size)
+        out += "...\n";
+
+      return out;
+    }
+
+    /*
+     * Lists the regular files in a directory.
+     *
+     * dir: The directory path
+     *
+     * Return value: The file paths, sorted, or an empty list if the directory
+     *               cannot be read or the platform is not supported
+     */
+    inline std::vector<std::string> list_files(const std::string& dir) {
+      std::vector<std::string> files;
+#ifdef ENKI_POSIX
+      DIR* d = ::opendir(dir.c_str());
+
+      if(!d)
+        return files;
+
+      while(struct dirent* entry = ::readdir(d)) {
+        std::string path = dir + "/" + entry->d_name;
+        struct stat st;
+
+        if(entry->d_name[0] != '.' && ::stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+          files.push_back(path);
       }
 
+      ::closedir(d);
+      std::sort(files.begin(), files.end());
+#endif /* ENKI_POSIX */
+      return files;
+    }
+
+    /*
+     * Coverage feedback state, filled in by the sanitizer coverage callbacks
+     * when ENKI_FUZZ_COVERAGE is defined (see the end of this file).
+     *
+     * The counters are per thread: a fuzzing worker points map to its own
+     * counters while it runs the fuzz target, so workers do not disturb each
+     * other and code run outside of the target is not counted.
+     */
+    template<typename D = void> struct CoverageState {
+      static std::uint32_t guards; /* Number of trace-pc-guard guards */
+      static thread_local std::uint8_t* map; /* Hit counters of the running worker, or nullptr */
+      static thread_local std::uint32_t map_size; /* Number of hit counters, a power of 2 */
+      static thread_local std::uint32_t* touched; /* Indices of the counters hit since the last collection, map_size at most */
+      static thread_local std::uint32_t touched_count; /* Number of touched indices */
+
       /*
-       * Asserts that all the elements in the given array are in the subdomain [min, max] from the domain T.
-       *
-       * arr: The array
-       * len_a: The length of the array
-       * min: The minimum value (inclusive)
-       * max: The maximum value (inclusive)
+       * Counts a hit.
        *
-       * T: The domain type
+       * index: The counter index
        */
-      template<typename T> static void assert_array_subdomain(const T* arr, size_t len_a, const T& min, const T& max) {
-        for(size_t t = 0; t < len_a; t++)
-          if(arr[t] < min || arr[t] > max)
-            throw TestFailedException();
+      ENKI_NO_COVERAGE static void hit(std::uint32_t index) {
+        std::uint8_t& hits = map[index & (map_size - 1)];
+
+        if(!hits)
+          touched[touched_count++] = index & (map_size - 1);
+
+        if(hits != 255)
+          hits++;
       }
-  };
+    };
+
+    template<typename D> std::uint32_t CoverageState<D>::guards = 0;
+    template<typename D> thread_local std::uint8_t* CoverageState<D>::map = nullptr;
+    template<typename D> thread_local std::uint32_t CoverageState<D>::map_size = 0;
+    template<typename D> thread_local std::uint32_t* CoverageState<D>::touched = nullptr;
+    template<typename D> thread_local std::uint32_t CoverageState<D>::touched_count = 0;
+  }
 
   /*
-   * Test case class. Subclasses of this class hold the test code and data.
+   * Memory used by a test.
    *
-   * This class itself is responsible for running the setup/cleanup functions,
-   * test running and success/failure identification, test data storage.
-   *
-   * T: The type of the child class
+   * The resident set size (RSS) figures are sampled from /proc/self on Linux
+   * and are left to 0 elsewhere. They are process wide, so they also count the
+   * memory used by the other threads meanwhile, and are exact only when a
+   * single test runs at a time on a fixture of its own. The allocation figures
+   * are only available when the allocation tracker is enabled (see
+   * ENKI_TRACK_ALLOCATIONS) and count the bytes allocated through operator new.
+   * They are process wide as well, so that memory handed between threads is
+   * accounted for, and share the same exactness.
    */
-  template<typename T> class TestCase {
-    public:
-      typedef void (T::*TestFunc)(); /* Test function type */
+  struct MemoryUsage {
+    long long peak_rss = 0; /* Peak RSS reached, over the RSS at the start, in bytes */
+    long long rss_growth = 0; /* RSS growth from the start to the end, in bytes */
+    long long peak_allocated = 0; /* Peak of the bytes allocated and not yet freed, over those at the start */
+    long long allocated_growth = 0; /* Bytes allocated and not freed from the start to the end */
+    bool tracked = false; /* true if the allocation figures are available */
+    bool approximate = true; /* true if the RSS and allocation figures may include memory used by other tests */
 
-      /* Test data structure */
-      typedef struct _TestData {
-        TestFunc func; /* Test function */
-        const char* name; /* Test name */
-        bool passed; /* Test result */
-        double time; /* Test duration in seconds */
-      } TestData;
+    /*
+     * Returns the peak memory used, from the allocation tracker if enabled or
+     * from the RSS if not.
+     *
+     * Return value: The peak memory in bytes
+     */
+    long long peak() const { return tracked? peak_allocated: peak_rss; }
+  };
+
+  namespace detail {
+    /*
+     * Allocation counters, updated by the allocation tracker (see the end of
+     * this file) for the memory allocated through operator new.
+     */
+    template<typename D = void> struct AllocationState {
+      static bool tracking; /* true if the allocation tracker is enabled */
+      static std::atomic<long long> current; /* Bytes allocated and not yet freed by the process */
+      static std::atomic<long long> peak; /* Peak of current since the last reset */
+    };
+
+    template<typename D> bool AllocationState<D>::tracking = false;
+    template<typename D> std::atomic<long long> AllocationState<D>::current(0);
+    template<typename D> std::atomic<long long> AllocationState<D>::peak(0);
+
+    /*
+     * Reads a small file of /proc into a buffer, without allocating.
+     *
+     * path: The file path
+     * buffer: The buffer, receiving a null terminated string
+     * size: The buffer size
+     *
+     * Return value: true on success, false if the file could not be read
+     */
+    inline bool read_proc(const char* path, char* buffer, size_t size) {
+#ifdef __linux__
+      int fd = open(path, O_RDONLY);
+      ssize_t length;
+
+      if(fd < 0)
+        return false;
+
+      length = read(fd, buffer, size - 1);
+      close(fd);
+
+      if(length < 0)
+        return false;
+
+      buffer[length] = '\0';
+
+      return true;
+#else
+      (void)path, (void)buffer, (void)size;
+
+      return false;
+#endif
+    }
+
+    /*
+     * Returns the resident set size of the process.
+     *
+     * Return value: The RSS in bytes, 0 if not available
+     */
+    inline long long resident_bytes() {
+      char buffer[128];
+      long long size, resident;
+
+      if(!read_proc("/proc/self/statm", buffer, sizeof(buffer)) || std::sscanf(buffer, "%lld %lld", &size, &resident) != 2)
+        return 0;
+
+#ifdef ENKI_POSIX
+      return resident * sysconf(_SC_PAGESIZE);
+#else
+      return 0;
+#endif
+    }
+
+    /*
+     * Returns the peak resident set size of the process (VmHWM).
+     *
+     * Return value: The peak RSS in bytes, 0 if not available
+     */
+    inline long long peak_resident_bytes() {
+      char buffer[4096];
+      const char* line;
+      long long kb;
+
+      if(!read_proc("/proc/self/status", buffer, sizeof(buffer)) || !(line = std::strstr(buffer, "VmHWM:")) || std::sscanf(line + 6, "%lld", &kb) != 1)
+        return 0;
+
+      return kb * 1024;
+    }
+
+    /*
+     * Resets the peak resident set size of the process to its current RSS.
+     *
+     * Return value: true on success, false if not supported
+     */
+    inline bool reset_peak_resident() {
+#ifdef __linux__
+      int fd = open("/proc/self/clear_refs", O_WRONLY);
+      bool done;
+
+      if(fd < 0)
+        return false;
+
+      done = write(fd, "5", 1) == 1;
+      close(fd);
+
+      return done;
+#else
+      return false;
+#endif
+    }
+
+    /*
+     * Measures the memory used from its construction to the call to finish().
+     * Probes can be nested: an inner probe does not hide the allocations it
+     * measures from the outer one.
+     */
+    class MemoryProbe {
+      public:
+        MemoryProbe(): reset(reset_peak_resident()), rss(resident_bytes()), hwm(peak_resident_bytes()),
+          allocated(AllocationState<>::current.load()), outer_peak(AllocationState<>::peak.load()) {
+          AllocationState<>::peak = allocated;
+        }
+
+        /*
+         * Stops the measurement.
+         *
+         * Return value: The memory used since the construction
+         */
+        MemoryUsage finish() {
+          MemoryUsage usage;
+          long long end_rss = resident_bytes();
+          long long end_hwm = peak_resident_bytes();
+
+          usage.rss_growth = end_rss - rss;
+          usage.peak_rss = std::max(0LL, reset? end_hwm - rss: end_hwm - hwm);
+          usage.approximate = !reset;
+          usage.tracked = AllocationState<>::tracking;
+
+          if(usage.tracked) {
+            usage.peak_allocated = AllocationState<>::peak - allocated;
+            usage.allocated_growth = AllocationState<>::current - allocated;
+          }
+
+          AllocationState<>::peak = std::max(outer_peak, AllocationState<>::peak.load());
+
+          return usage;
+        }
+
+      private:
+        bool reset; /* true if the peak RSS was reset */
+        long long rss; /* RSS at the start */
+        long long hwm; /* Peak RSS at the start */
+        long long allocated; /* Bytes allocated by the process at the start */
+        long long outer_peak; /* Allocation peak of the enclosing measurement */
+    };
+  }
+
+  /*
+   * Low overhead timer, used to time the tests and the benchmarks.
+   *
+   * The timer reads the CPU cycle counter: the TSC on x86-64, when it is
+   * invariant (it ticks at a constant rate whatever the frequency and power
+   * state of the core), or the generic timer counter on AArch64. The counter
+   * is calibrated against std::chrono::steady_clock on first use. Elsewhere, or
+   * if the TSC is not invariant, steady_clock itself is used.
+   *
+   * The cost of a start()/stop() pair, measured during calibration, is
+   * subtracted from the elapsed times.
+   */
+  class Timer {
+    public:
+      typedef std::uint64_t Ticks; /* Counter value type */
+
+      /*
+       * Calibrates the timer, if not done yet. Calibration takes a few tens of
+       * milliseconds, which otherwise go to the first measurement.
+       */
+      static void init() { calibration(); }
+
+      /*
+       * Reads the counter at the start of a measurement. The reading is not
+       * reordered before the preceding instructions.
+       *
+       * Return value: The counter value
+       */
+      static inline Ticks start() { return calibration().cycles? begin_cycles(): clock(); }
+
+      /*
+       * Reads the counter at the end of a measurement. The reading is not
+       * reordered after the following instructions.
+       *
+       * Return value: The counter value
+       */
+      static inline Ticks stop() { return calibration().cycles? end_cycles(): clock(); }
+
+      /*
+       * Returns the time between two counter readings, less the measurement
+       * overhead.
+       *
+       * t1: The start() reading
+       * t2: The stop() reading
+       *
+       * Return value: The elapsed time in nanoseconds
+       */
+      static std::uint64_t elapsed_ns(Ticks t1, Ticks t2) {
+        const Calibration& c = calibration();
+        Ticks ticks = t2 - t1 > c.overhead? t2 - t1 - c.overhead: 0;
+
+        return static_cast<std::uint64_t>(std::llround(ticks * c.ns_per_tick));
+      }
+
+      /*
+       * Returns the time between two counter readings, less the measurement
+       * overhead.
+       *
+       * t1: The start() reading
+       * t2: The stop() reading
+       *
+       * Return value: The elapsed time in seconds
+       */
+      static double elapsed(Ticks t1, Ticks t2) { return elapsed_ns(t1, t2) * 1e-9; }
+
+      /*
+       * Checks whether the timer reads the CPU cycle counter.
+       *
+       * Return value: true if the cycle counter is used, false if steady_clock is
+       */
+      static bool is_cycle_counter() { return calibration().cycles; }
+
+      /*
+       * Returns the duration of a counter tick.
+       *
+       * Return value: The tick duration in nanoseconds
+       */
+      static double tick_ns() { return calibration().ns_per_tick; }
+
+      /*
+       * Returns the measurement overhead subtracted from the elapsed times.
+       *
+       * Return value: The overhead in nanoseconds
+       */
+      static double overhead_ns() { return calibration().overhead * calibration().ns_per_tick; }
+
+    private:
+      /* Timer calibration data */
+      struct Calibration {
+        bool cycles; /* true if the cycle counter is used */
+        double ns_per_tick; /* Tick duration in nanoseconds */
+        Ticks overhead; /* Ticks taken by a start()/stop() pair */
+      };
+
+      static const Calibration& calibration() {
+        static const Calibration c = calibrate();
+
+        return c;
+      }
+
+      static Calibration calibrate() {
+        Calibration c = { has_cycle_counter(), 1.0, 0 };
+        Ticks (*read_start)() = c.cycles? begin_cycles: clock;
+        Ticks (*read_stop)() = c.cycles? end_cycles: clock;
+
+#if defined(__GNUC__) && defined(__aarch64__)
+        Ticks frequency;
+
+        asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+
+        if(frequency)
+          c.ns_per_tick = 1e9 / frequency;
+#else
+        if(c.cycles) {
+          std::chrono::steady_clock::time_point w1 = std::chrono::steady_clock::now(), w2;
+          Ticks t1 = begin_cycles(), t2;
+
+          do
+            w2 = std::chrono::steady_clock::now();
+          while(w2 - w1 < std::chrono::milliseconds(20));
+
+          t2 = end_cycles();
+          c.ns_per_tick = std::chrono::duration<double, std::nano>(w2 - w1).count() / (t2 - t1);
+        }
+#endif
+
+        /* The smallest of many empty measurements */
+        c.overhead = std::numeric_limits<Ticks>::max();
+
+        for(int t = 0; t < 1000; t++) {
+          Ticks t1 = read_start();
+          Ticks t2 = read_stop();
+
+          c.overhead = std::min(c.overhead, t2 - t1);
+        }
+
+        return c;
+      }
+
+      static bool has_cycle_counter() {
+#if defined(__GNUC__) && defined(__x86_64__)
+        unsigned eax, ebx, ecx, edx;
+
+        /* Invariant TSC (CPUID 0x80000007, EDX bit 8) and RDTSCP (CPUID 0x80000001, EDX bit 27) */
+        if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 8)))
+          return false;
+
+        return __get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx) && (edx & (1u << 27));
+#elif defined(__GNUC__) && defined(__aarch64__)
+        return true;
+#else
+        return false;
+#endif
+      }
+
+      static inline Ticks begin_cycles() {
+#if defined(__GNUC__) && defined(__x86_64__)
+        unsigned lo, hi;
+
+        asm volatile("lfence\n\trdtsc" : "=a"(lo), "=d"(hi) : : "memory");
+
+        return (Ticks(hi) << 32) | lo;
+#elif defined(__GNUC__) && defined(__aarch64__)
+        Ticks t;
+
+        asm volatile("isb\n\tmrs %0, cntvct_el0" : "=r"(t) : : "memory");
+
+        return t;
+#else
+        return clock();
+#endif
+      }
+
+      static inline Ticks end_cycles() {
+#if defined(__GNUC__) && defined(__x86_64__)
+        unsigned lo, hi, aux;
+
+        asm volatile("rdtscp\n\tlfence" : "=a"(lo), "=d"(hi), "=c"(aux) : : "memory");
+
+        return (Ticks(hi) << 32) | lo;
+#elif defined(__GNUC__) && defined(__aarch64__)
+        Ticks t;
+
+        asm volatile("isb\n\tmrs %0, cntvct_el0\n\tisb" : "=r"(t) : : "memory");
+
+        return t;
+#else
+        return clock();
+#endif
+      }
+
+      static inline Ticks clock() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+      }
+  };
+
+  /*
+   * Resources used by a thread: CPU time, context switches and page faults.
+   *
+   * On Linux the usage is the one of the calling thread; on the other POSIX
+   * systems it is the one of the whole process, which is only accurate while
+   * a single thread runs. Elsewhere all the fields are left to 0.
+   */
+  struct ResourceUsage {
+    double user_time = 0.0; /* User CPU time in seconds */
+    double system_time = 0.0; /* System CPU time in seconds */
+    long voluntary_switches = 0; /* Context switches due to the thread blocking */
+    long involuntary_switches = 0; /* Context switches due to the thread being preempted */
+    long minor_faults = 0; /* Page faults served without I/O */
+    long major_faults = 0; /* Page faults requiring I/O */
+
+    /*
+     * Returns the resources used by the calling thread so far.
+     *
+     * Return value: The resource usage
+     */
+    static ResourceUsage thread() {
+      ResourceUsage usage;
+
+#ifdef ENKI_POSIX
+      struct rusage ru;
+
+  #ifdef RUSAGE_THREAD
+      if(!getrusage(RUSAGE_THREAD, &ru)) {
+  #else
+      if(!getrusage(RUSAGE_SELF, &ru)) {
+  #endif
+        usage.user_time = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6;
+        usage.system_time = ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+        usage.voluntary_switches = ru.ru_nvcsw;
+        usage.involuntary_switches = ru.ru_nivcsw;
+        usage.minor_faults = ru.ru_minflt;
+        usage.major_faults = ru.ru_majflt;
+      }
+#endif /* ENKI_POSIX */
+
+      return usage;
+    }
+
+    ResourceUsage operator-(const ResourceUsage& other) const {
+      ResourceUsage usage(*this);
+
+      usage.user_time -= other.user_time;
+      usage.system_time -= other.system_time;
+      usage.voluntary_switches -= other.voluntary_switches;
+      usage.involuntary_switches -= other.involuntary_switches;
+      usage.minor_faults -= other.minor_faults;
+      usage.major_faults -= other.major_faults;
+
+      return usage;
+    }
+
+    ResourceUsage& operator+=(const ResourceUsage& other) {
+      user_time += other.user_time;
+      system_time += other.system_time;
+      voluntary_switches += other.voluntary_switches;
+      involuntary_switches += other.involuntary_switches;
+      minor_faults += other.minor_faults;
+      major_faults += other.major_faults;
+
+      return *this;
+    }
+  };
+
+  namespace detail {
+    /*
+     * Makes a value opaque to the optimizer. Integers and pointers are kept in
+     * a register, other values are forced to memory.
+     */
+    template<typename V> inline void escape(V& value, std::true_type) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__aarch64__))
+      asm volatile("" : "+r"(value) : : "memory");
+#else
+      escape(value, std::false_type());
+#endif
+    }
+
+    template<typename V> inline void escape(V& value, std::false_type) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__aarch64__))
+      asm volatile("" : "+m"(value) : : "memory");
+#else
+      static const void* volatile sink;
+
+      sink = &value;
+      std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+    }
+  }
+
+  /*
+   * Prevents the optimizer from discarding the computation of a value, as if
+   * the value was read by code the compiler cannot see.
+   *
+   * value: The value
+   */
+  template<typename V> inline void do_not_optimize(const V& value) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__aarch64__))
+    asm volatile("" : : "m"(value) : "memory");
+#else
+    static const void* volatile sink;
+
+    sink = &value;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+  }
+
+  /*
+   * Prevents the optimizer from discarding the computation of a value, or
+   * from assuming anything about the value afterwards, as if the value was
+   * read and written by code the compiler cannot see.
+   *
+   * value: The value
+   */
+  template<typename V> inline void do_not_optimize(V& value) {
+    detail::escape(value, std::integral_constant<bool, std::is_integral<V>::value || std::is_pointer<V>::value>());
+  }
+
+  /*
+   * Forces the pending writes to memory to be performed before this point,
+   * and the reads after it to be performed again, as if all the memory was
+   * read and written by code the compiler cannot see.
+   */
+  inline void clobber_memory() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__aarch64__))
+    asm volatile("" : : : "memory");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+  }
+
+  namespace detail {
+    /*
+     * Returns the size of the largest CPU cache, read from /sys on Linux.
+     *
+     * Return value: The cache size in bytes, 32MiB if unknown
+     */
+    inline size_t cache_size() {
+      size_t size = 0;
+#if defined(__linux__)
+      char buffer[64];
+
+      for(int index = 0; ; index++) {
+        std::string path = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/size";
+        char* end;
+        size_t bytes;
+
+        if(!read_proc(path.c_str(), buffer, sizeof(buffer)))
+          break;
+
+        bytes = std::strtoul(buffer, &end, 10);
+        bytes <<= *end == 'K'? 10: *end == 'M'? 20: 0;
+        size = std::max(size, bytes);
+      }
+#endif /* __linux__ */
+
+      return size? size: 32 << 20;
+    }
+
+    /* Buffer read by flush_cache() */
+    struct FlushBuffer {
+      const char* data; /* Buffer, nullptr if it could not be allocated */
+      size_t size; /* Buffer size in bytes, 0 if it could not be allocated */
+
+      /*
+       * Returns the buffer, allocating and touching it on first use, outside
+       * of the allocation tracking.
+       *
+       * Return value: The buffer
+       */
+      static const FlushBuffer& get() {
+        static const FlushBuffer buffer = allocate(2 * cache_size());
+
+        return buffer;
+      }
+
+      static FlushBuffer allocate(size_t size) {
+        void* data = std::malloc(size);
+
+        if(!data)
+          return FlushBuffer{nullptr, 0};
+
+        return FlushBuffer{static_cast<const char*>(std::memset(data, 1, size)), size};
+      }
+    };
+  }
+
+  /*
+   * Evicts the data of the calling thread from the CPU caches, by reading a
+   * buffer twice as large as the largest cache. The buffer is allocated and
+   * touched on first use, which TestCase::run() does before any test when
+   * caches are to be flushed, so that its page faults and resident memory
+   * are not charged to a test. If it cannot be allocated, nothing is flushed.
+   */
+  inline void flush_cache() {
+    const detail::FlushBuffer& buffer = detail::FlushBuffer::get();
+    char sum = 0;
+
+    for(size_t t = 0; t < buffer.size; t += 64)
+      sum += buffer.data[t];
+
+    do_not_optimize(sum);
+    clobber_memory();
+  }
+
+  /*
+   * Evicts a block of memory from the CPU caches. Where the architecture has
+   * no cache line flush instruction, the whole cache is flushed instead.
+   *
+   * data: The memory block
+   * size: The block size in bytes
+   */
+  inline void flush_cache(const void* data, size_t size) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__aarch64__))
+    const char* begin = static_cast<const char*>(data);
+
+    for(const char* line = begin; line < begin + size; line += 64)
+  #if defined(__x86_64__)
+      __builtin_ia32_clflush(line);
+
+    __builtin_ia32_mfence();
+  #else
+      asm volatile("dc civac, %0" : : "r" (line) : "memory");
+
+    asm volatile("dsb ish" : : : "memory");
+  #endif /* __x86_64__ */
+#else
+    (void)data, (void)size;
+
+    flush_cache();
+#endif
+  }
+
+  /*
+   * Placement of worker threads over the CPUs.
+   */
+  enum class Placement {
+    NONE, /* Threads are left to the scheduler */
+    PACK, /* Threads fill the CPUs of a NUMA node before moving to the next node */
+    SPREAD /* Threads go to each NUMA node in turn */
+  };
+
+  /*
+   * Benchmark configuration.
+   */
+  struct BenchmarkConfig {
+    double min_time = 0.5; /* Minimum measured time in seconds, the iterations grow until it is reached */
+    size_t min_iterations = 1; /* Minimum number of iterations */
+    size_t max_iterations = 1000000000; /* Maximum number of iterations */
+    bool complexity = false; /* true to fit the times of the instances of a benchmark to a complexity class */
+    std::vector<unsigned> threads; /* Numbers of threads to run the benchmark on, one instance each; empty to run it on the calling thread */
+    std::vector<int> cpus; /* CPUs the benchmark threads are pinned to, thread i to cpus[i % cpus.size()]; empty not to pin them */
+    Placement placement = Placement::NONE; /* Placement of the benchmark threads when cpus is empty */
+    size_t warmup_iterations = 0; /* Iterations run before the measurement, untimed */
+    size_t cold_iterations = 0; /* Iterations measured again with the caches flushed before each (see flush_cache()), 0 not to */
+  };
+
+  /*
+   * Benchmark result.
+   */
+  struct BenchmarkResult {
+    size_t iterations = 0; /* Number of measured iterations, 0 for tests that are not benchmarks */
+    double time = 0.0; /* Measured time in seconds */
+    long long complexity_n = 0; /* Input size the time is fitted against, see Benchmark::set_complexity_n() */
+    unsigned threads = 1; /* Number of threads, each running the given iterations; time is their mean */
+    double first_time = 0.0; /* Time of the very first iteration, with cold caches and lazy initialization, in seconds */
+    size_t cold_iterations = 0; /* Number of iterations measured with cold caches */
+    double cold_time = 0.0; /* Measured time of the cold iterations in seconds, flushing excluded */
+
+    /*
+     * Returns the time of a single iteration.
+     *
+     * Return value: The time per iteration in seconds
+     */
+    double time_per_iteration() const { return iterations? time / iterations: 0.0; }
+
+    /*
+     * Returns the time of a single iteration with cold caches.
+     *
+     * Return value: The time per cold iteration in seconds
+     */
+    double cold_time_per_iteration() const { return cold_iterations? cold_time / cold_iterations: 0.0; }
+  };
+
+  /*
+   * Kinds of user defined counters.
+   */
+  enum class CounterKind {
+    TOTAL, /* The value is reported as is */
+    RATE, /* The value is reported per second */
+    AVERAGE /* The value is reported per benchmark iteration */
+  };
+
+  /*
+   * Throughput counters of a test: the bytes and items it processed and its
+   * user defined counters. Rates are computed over the measured time, that is
+   * the benchmark loop for benchmarks and the whole run for the other tests.
+   */
+  struct Counters {
+    double bytes = 0.0; /* Bytes processed */
+    double items = 0.0; /* Items processed */
+    std::vector<std::pair<std::string, std::pair<double, CounterKind>>> user; /* User counters: name, value and kind, in declaration order */
+    double time = 0.0; /* Measured time in seconds */
+    size_t iterations = 1; /* Number of measured iterations */
+
+    /*
+     * Checks whether any counter was declared.
+     *
+     * Return value: true if there are counters to report
+     */
+    bool empty() const { return bytes == 0.0 && items == 0.0 && user.empty(); }
+
+    /*
+     * Returns the bytes processed per second.
+     *
+     * Return value: The byte rate, 0 if not available
+     */
+    double bytes_per_second() const { return time > 0.0? bytes / time: 0.0; }
+
+    /*
+     * Returns the items processed per second.
+     *
+     * Return value: The item rate, 0 if not available
+     */
+    double items_per_second() const { return time > 0.0? items / time: 0.0; }
+
+    /*
+     * Returns the reported value of a user counter, according to its kind.
+     *
+     * index: The counter index into user
+     *
+     * Return value: The reported value
+     */
+    double value(size_t index) const {
+      double v = user[index].second.first;
+
+      switch(user[index].second.second) {
+        case CounterKind::RATE: return time > 0.0? v / time: 0.0;
+        case CounterKind::AVERAGE: return iterations? v / iterations: 0.0;
+        default: return v;
+      }
+    }
+
+    /*
+     * Sets a user counter, replacing the counter with the same name.
+     *
+     * name: The counter name
+     * value: The counter value
+     * kind: The counter kind
+     */
+    void set(const std::string& name, double value, CounterKind kind) {
+      for(size_t t = 0; t < user.size(); t++) {
+        if(user[t].first == name) {
+          user[t].second = std::make_pair(value, kind);
+
+          return;
+        }
+      }
+
+      user.push_back(std::make_pair(name, std::make_pair(value, kind)));
+    }
+  };
+
+  /*
+   * Log-bucketed latency histogram, in the style of HdrHistogram. Values are
+   * durations in nanoseconds, kept with a relative precision of 1/64 (about
+   * 1.6%) in a fixed set of buckets covering the whole 64 bit range.
+   *
+   * Recording is lock-free and wait-free but for the minimum and maximum, so
+   * that many threads can record into the same histogram; histograms of
+   * different threads can also be merged after the fact.
+   */
+  class LatencyHistogram {
+    public:
+      static const unsigned SUB_BITS = 6; /* Bits of precision of each bucket */
+      static const size_t BUCKETS = (64 - SUB_BITS + 1) << SUB_BITS; /* Number of buckets */
+
+      LatencyHistogram() { reset(); }
+
+      LatencyHistogram(const LatencyHistogram& histogram) { *this = histogram; }
+
+      LatencyHistogram& operator=(const LatencyHistogram& histogram) {
+        if(this != &histogram) {
+          reset();
+          merge(histogram);
+        }
+
+        return *this;
+      }
+
+      /*
+       * Records a value.
+       *
+       * ns: The value in nanoseconds
+       */
+      void record(std::uint64_t ns) {
+        std::uint64_t min = this->min.load(std::memory_order_relaxed), max = this->max.load(std::memory_order_relaxed);
+
+        buckets[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(ns, std::memory_order_relaxed);
+
+        while(ns < min && !this->min.compare_exchange_weak(min, ns, std::memory_order_relaxed));
+        while(ns > max && !this->max.compare_exchange_weak(max, ns, std::memory_order_relaxed));
+      }
+
+      /*
+       * Records the time between two Timer readings.
+       *
+       * t1: The Timer::start() reading
+       * t2: The Timer::stop() reading
+       */
+      void record(Timer::Ticks t1, Timer::Ticks t2) { record(Timer::elapsed_ns(t1, t2)); }
+
+      /*
+       * Adds the values of another histogram to this one.
+       *
+       * histogram: The histogram to add
+       */
+      void merge(const LatencyHistogram& histogram) {
+        std::uint64_t min = this->min.load(std::memory_order_relaxed), max = this->max.load(std::memory_order_relaxed);
+        std::uint64_t other_min = histogram.get_min(), other_max = histogram.get_max();
+
+        for(size_t t = 0; t < BUCKETS; t++) {
+          std::uint64_t n = histogram.buckets[t].load(std::memory_order_relaxed);
+
+          if(n)
+            buckets[t].fetch_add(n, std::memory_order_relaxed);
+        }
+
+        count.fetch_add(histogram.get_count(), std::memory_order_relaxed);
+        sum.fetch_add(histogram.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+        while(histogram.get_count() && other_min < min && !this->min.compare_exchange_weak(min, other_min, std::memory_order_relaxed));
+        while(other_max > max && !this->max.compare_exchange_weak(max, other_max, std::memory_order_relaxed));
+      }
+
+      /*
+       * Removes all the values.
+       */
+      void reset() {
+        for(size_t t = 0; t < BUCKETS; t++)
+          buckets[t].store(0, std::memory_order_relaxed);
+
+        count.store(0, std::memory_order_relaxed);
+        sum.store(0, std::memory_order_relaxed);
+        min.store(std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+        max.store(0, std::memory_order_relaxed);
+      }
+
+      /*
+       * Returns the number of recorded values.
+       *
+       * Return value: The number of values
+       */
+      std::uint64_t get_count() const { return count.load(std::memory_order_relaxed); }
+
+      /*
+       * Returns the smallest recorded value.
+       *
+       * Return value: The smallest value in nanoseconds, 0 if the histogram is empty
+       */
+      std::uint64_t get_min() const { return get_count()? min.load(std::memory_order_relaxed): 0; }
+
+      /*
+       * Returns the largest recorded value.
+       *
+       * Return value: The largest value in nanoseconds
+       */
+      std::uint64_t get_max() const { return max.load(std::memory_order_relaxed); }
+
+      /*
+       * Returns the mean of the recorded values.
+       *
+       * Return value: The mean in nanoseconds, 0 if the histogram is empty
+       */
+      double get_mean() const { return get_count()? double(sum.load(std::memory_order_relaxed)) / get_count(): 0.0; }
+
+      /*
+       * Returns a percentile of the recorded values: the highest value of the
+       * bucket holding it, within the precision of the histogram and never
+       * above the largest recorded value.
+       *
+       * p: The percentile, from 0 to 100, e.g. 99.9
+       *
+       * Return value: The percentile in nanoseconds, 0 if the histogram is empty
+       */
+      std::uint64_t percentile(double p) const {
+        std::uint64_t total = get_count(), rank, seen = 0;
+
+        if(!total)
+          return 0;
+
+        rank = std::max<std::uint64_t>(static_cast<std::uint64_t>(std::ceil(std::min(std::max(p, 0.0), 100.0) / 100.0 * total)), 1);
+
+        for(size_t t = 0; t < BUCKETS; t++) {
+          seen += buckets[t].load(std::memory_order_relaxed);
+
+          if(seen >= rank)
+            return std::min(highest(t), get_max());
+        }
+
+        return get_max();
+      }
+
+    private:
+      /*
+       * Returns the bucket of a value: values below 2^(SUB_BITS + 1) have their
+       * own bucket, the others share it with the values differing only past
+       * their SUB_BITS + 1 most significant bits.
+       *
+       * ns: The value
+       *
+       * Return value: The bucket index
+       */
+      static size_t bucket(std::uint64_t ns) {
+        unsigned shift = 0;
+
+        if(ns >= (std::uint64_t(2) << SUB_BITS)) {
+#if defined(__GNUC__)
+          shift = 63 - __builtin_clzll(ns) - SUB_BITS;
+#else
+          while((ns >> shift) >= (std::uint64_t(2) << SUB_BITS))
+            shift++;
+#endif /* __GNUC__ */
+        }
+
+        return (size_t(shift) << SUB_BITS) + (ns >> shift);
+      }
+
+      /*
+       * Returns the highest value of a bucket.
+       *
+       * index: The bucket index
+       *
+       * Return value: The highest value
+       */
+      static std::uint64_t highest(size_t index) {
+        unsigned shift = index < (size_t(2) << SUB_BITS)? 0: static_cast<unsigned>((index >> SUB_BITS) - 1);
+        std::uint64_t mantissa = index - (size_t(shift) << SUB_BITS);
+
+        return (mantissa << shift) + ((std::uint64_t(1) << shift) - 1);
+      }
+
+      std::atomic<std::uint64_t> buckets[BUCKETS]; /* Value counts by bucket */
+      std::atomic<std::uint64_t> count; /* Number of values */
+      std::atomic<std::uint64_t> sum; /* Sum of the values, wrapping after 584 years */
+      std::atomic<std::uint64_t> min; /* Smallest value */
+      std::atomic<std::uint64_t> max; /* Largest value */
+  };
+
+  namespace detail {
+    /*
+     * Latency histograms of a test run, by operation. Looking up a histogram
+     * takes a lock, recording into it does not.
+     */
+    class LatencyTable {
+      public:
+        LatencyTable() {}
+
+        LatencyTable(const LatencyTable& table) { *this = table; }
+
+        LatencyTable& operator=(const LatencyTable& table) {
+          if(this != &table) {
+            std::vector<std::pair<std::string, LatencyHistogram>> histograms = table.get_histograms();
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            this->histograms.clear();
+
+            for(size_t t = 0; t < histograms.size(); t++)
+              this->histograms.push_back(std::make_pair(histograms[t].first, std::unique_ptr<LatencyHistogram>(new LatencyHistogram(histograms[t].second))));
+          }
+
+          return *this;
+        }
+
+        /*
+         * Returns the histogram of an operation, creating it on first use.
+         *
+         * name: The operation name
+         *
+         * Return value: The histogram
+         */
+        LatencyHistogram& get(const std::string& name) {
+          std::lock_guard<std::mutex> lock(mutex);
+
+          for(size_t t = 0; t < histograms.size(); t++)
+            if(histograms[t].first == name)
+              return *histograms[t].second;
+
+          histograms.push_back(std::make_pair(name, std::unique_ptr<LatencyHistogram>(new LatencyHistogram())));
+
+          return *histograms.back().second;
+        }
+
+        /*
+         * Returns a copy of the histograms.
+         *
+         * Return value: The operation names and their histograms, in creation order
+         */
+        std::vector<std::pair<std::string, LatencyHistogram>> get_histograms() const {
+          std::vector<std::pair<std::string, LatencyHistogram>> copy;
+          std::lock_guard<std::mutex> lock(mutex);
+
+          for(size_t t = 0; t < histograms.size(); t++)
+            copy.push_back(std::make_pair(histograms[t].first, *histograms[t].second));
+
+          return copy;
+        }
+
+      private:
+        mutable std::mutex mutex; /* Lookup lock */
+        std::vector<std::pair<std::string, std::unique_ptr<LatencyHistogram>>> histograms; /* Histograms, by operation */
+    };
+
+    /*
+     * Receivers of the benchmark result, of the counters and of the latencies
+     * of the test running on each thread.
+     */
+    template<typename D = void> struct BenchmarkState {
+      static thread_local BenchmarkResult* result; /* Result of the running test, or nullptr */
+      static thread_local Counters* counters; /* Counters of the running test, or nullptr */
+      static thread_local LatencyTable* latencies; /* Latency histograms of the running test, or nullptr */
+      static thread_local ResourceUsage* workers; /* Resources used by the benchmark threads of the running test, or nullptr */
+
+      /*
+       * Returns a latency histogram of the running test.
+       *
+       * name: The operation name
+       *
+       * Return value: The histogram, or a histogram recording nowhere outside of a test
+       */
+      static LatencyHistogram& latency(const std::string& name) {
+        static LatencyHistogram discarded;
+
+        return latencies? latencies->get(name): discarded;
+      }
+    };
+
+    template<typename D> thread_local BenchmarkResult* BenchmarkState<D>::result = nullptr;
+    template<typename D> thread_local Counters* BenchmarkState<D>::counters = nullptr;
+    template<typename D> thread_local LatencyTable* BenchmarkState<D>::latencies = nullptr;
+    template<typename D> thread_local ResourceUsage* BenchmarkState<D>::workers = nullptr;
+
+    /*
+     * Thread barrier, releasing the waiting threads once all of them have
+     * arrived. A cancelled barrier releases its waiting threads at once.
+     */
+    class Barrier {
+      public:
+        explicit Barrier(unsigned count): count(count), waiting(0), cancelled(false) {}
+
+        /*
+         * Waits for all the threads to arrive.
+         *
+         * Return value: true if all the threads arrived, false if the barrier was cancelled
+         */
+        bool wait() {
+          std::unique_lock<std::mutex> lock(mutex);
+
+          if(++waiting >= count)
+            released.notify_all();
+          else
+            released.wait(lock, [this] () { return waiting >= count || cancelled; });
+
+          return !cancelled;
+        }
+
+        /*
+         * Cancels the barrier, e.g. when a thread fails before reaching it.
+         */
+        void cancel() {
+          std::lock_guard<std::mutex> lock(mutex);
+
+          cancelled = true;
+          released.notify_all();
+        }
+
+      private:
+        unsigned count; /* Number of threads */
+        unsigned waiting; /* Number of threads arrived */
+        bool cancelled; /* true once cancelled */
+        std::mutex mutex; /* Barrier lock */
+        std::condition_variable released; /* Signalled when the threads are released */
+    };
+
+    /*
+     * Pins the calling thread to a CPU. Only supported on Linux.
+     *
+     * cpu: The CPU index
+     *
+     * Return value: true on success, false if not
+     */
+    inline bool pin_thread(int cpu) {
+#if defined(__linux__)
+      cpu_set_t set;
+
+      CPU_ZERO(&set);
+      CPU_SET(cpu, &set);
+
+      return !pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+      (void)cpu;
+
+      return false;
+#endif
+    }
+
+    /*
+     * Parses a Linux CPU list, such as "0-3,8,10-11".
+     *
+     * list: The CPU list
+     *
+     * Return value: The CPUs
+     */
+    inline std::vector<int> parse_cpu_list(const char* list) {
+      std::vector<int> cpus;
+
+      while(*list >= '0' && *list <= '9') {
+        char* end;
+        int first = static_cast<int>(std::strtol(list, &end, 10)), last = first;
+
+        if(*end == '-')
+          last = static_cast<int>(std::strtol(end + 1, &end, 10));
+
+        for(int cpu = first; cpu <= last; cpu++)
+          cpus.push_back(cpu);
+
+        list = *end == ','? end + 1: end;
+      }
+
+      return cpus;
+    }
+
+#if defined(__linux__)
+    /*
+     * Reads the busy and total times of each CPU from /proc/stat.
+     *
+     * Return value: The busy and total times in clock ticks, by CPU
+     */
+    inline std::map<int, std::pair<unsigned long long, unsigned long long>> cpu_times() {
+      std::map<int, std::pair<unsigned long long, unsigned long long>> times;
+      std::ifstream is("/proc/stat");
+      std::string line;
+
+      while(std::getline(is, line)) {
+        unsigned long long v[8] = {}, total = 0;
+        int cpu;
+
+        /* Such as "cpu3 user nice system idle iowait irq softirq steal ...", the line of all CPUs having no number */
+        if(line.compare(0, 3, "cpu") || line.size() < 4 || line[3] < '0' || line[3] > '9' || std::sscanf(line.c_str(), "cpu%d %llu %llu %llu %llu %llu %llu %llu %llu", &cpu, v, v + 1, v + 2, v + 3, v + 4, v + 5, v + 6, v + 7) < 5)
+          continue;
+
+        for(int t = 0; t < 8; t++)
+          total += v[t];
+
+        times[cpu] = std::make_pair(total - v[3] - v[4], total);
+      }
+
+      return times;
+    }
+#endif /* __linux__ */
+
+    /*
+     * CPU topology: the CPUs of each NUMA node, read from /sys on Linux. Without
+     * NUMA information, all the CPUs are on node 0.
+     */
+    class Topology {
+      public:
+        /*
+         * Returns the topology of the machine, read on first use.
+         *
+         * Return value: The topology
+         */
+        static const Topology& get() {
+          static const Topology topology;
+
+          return topology;
+        }
+
+        /*
+         * Returns the CPUs of each node.
+         *
+         * Return value: The CPUs, by node
+         */
+        const std::vector<std::vector<int>>& get_nodes() const { return nodes; }
+
+        /*
+         * Returns the node of a CPU.
+         *
+         * cpu: The CPU
+         *
+         * Return value: The node, -1 if the CPU is unknown
+         */
+        int node_of(int cpu) const {
+          for(size_t n = 0; n < nodes.size(); n++)
+            if(std::find(nodes[n].begin(), nodes[n].end(), cpu) != nodes[n].end())
+              return static_cast<int>(n);
+
+          return -1;
+        }
+
+        /*
+         * Returns the order the CPUs are given to worker threads in: worker w
+         * runs on order[w % order.size()].
+         *
+         * placement: The placement, PACK or SPREAD
+         *
+         * Return value: The CPUs, in order
+         */
+        std::vector<int> order(Placement placement) const {
+          std::vector<int> cpus;
+
+          if(placement == Placement::PACK) {
+            for(size_t n = 0; n < nodes.size(); n++)
+              cpus.insert(cpus.end(), nodes[n].begin(), nodes[n].end());
+          } else {
+            for(size_t c = 0; cpus.size() < count; c++)
+              for(size_t n = 0; n < nodes.size(); n++)
+                if(c < nodes[n].size())
+                  cpus.push_back(nodes[n][c]);
+          }
+
+          return cpus;
+        }
+
+      private:
+        Topology(): count(0) {
+          char buffer[1024];
+
+          /* Node directories may be sparse, stop after a run of missing ones */
+          for(int n = 0, missing = 0; missing < 64; n++) {
+            std::string path = "/sys/devices/system/node/node" + std::to_string(n) + "/cpulist";
+
+            if(!read_proc(path.c_str(), buffer, sizeof(buffer))) {
+              missing++;
+              continue;
+            }
+
+            nodes.resize(n + 1);
+            nodes[n] = parse_cpu_list(buffer);
+            count += nodes[n].size();
+            missing = 0;
+          }
+
+          if(!count) {
+            std::vector<int> cpus;
+
+            if(read_proc("/sys/devices/system/cpu/online", buffer, sizeof(buffer)))
+              cpus = parse_cpu_list(buffer);
+
+            for(unsigned cpu = 0; cpus.empty() && cpu < hardware_workers(); cpu++)
+              cpus.push_back(cpu);
+
+            nodes.assign(1, cpus);
+            count = cpus.size();
+          }
+        }
+
+        std::vector<std::vector<int>> nodes; /* CPUs, by node */
+        size_t count; /* Number of CPUs */
+    };
+
+    /*
+     * Prefers the memory of a NUMA node for the allocations of the calling
+     * thread, through the set_mempolicy system call. Only supported on Linux.
+     *
+     * node: The node, -1 to restore the default policy
+     *
+     * Return value: true on success, false if not
+     */
+    inline bool bind_memory(int node) {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+      const int MPOL_DEFAULT = 0, MPOL_PREFERRED = 1;
+      unsigned long mask[16] = {};
+
+      if(node < 0)
+        return !syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0);
+
+      if(node >= static_cast<int>(sizeof(mask) * 8))
+        return false;
+
+      mask[node / (sizeof(unsigned long) * 8)] = 1UL << (node % (sizeof(unsigned long) * 8));
+
+      return !syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, sizeof(mask) * 8);
+#else
+      (void)node;
+
+      return false;
+#endif
+    }
+
+    /*
+     * Returns the CPU the calling thread was placed on by place_thread().
+     *
+     * Return value: The CPU, -1 if the thread is not placed
+     */
+    inline int& placed_cpu() {
+      static thread_local int cpu = -1;
+
+      return cpu;
+    }
+
+    /*
+     * Places the calling thread as a worker: pins it to the CPU its index gets
+     * under a placement and, optionally, binds its allocations to the node of
+     * that CPU. A thread is only moved when its placement changes.
+     *
+     * placement: The placement
+     * worker: The worker index
+     * memory: true to bind the allocations to the local node
+     */
+    inline void place_thread(Placement placement, unsigned worker, bool memory) {
+      int& placed = placed_cpu();
+      std::vector<int> cpus;
+      int cpu;
+
+      if(placement == Placement::NONE)
+        return;
+
+      cpus = Topology::get().order(placement);
+
+      if(cpus.empty())
+        return;
+
+      cpu = cpus[worker % cpus.size()];
+
+      if(cpu == placed)
+        return;
+
+      if(pin_thread(cpu) && memory)
+        bind_memory(Topology::get().node_of(cpu));
+
+      placed = cpu;
+    }
+
+    /*
+     * Saves the CPU affinity of the calling thread and restores it, along with
+     * the default memory policy, when destroyed.
+     */
+    class AffinityGuard {
+      public:
+        explicit AffinityGuard(bool active): active(active) {
+#if defined(__linux__)
+          if(active)
+            saved = !pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+        }
+
+        AffinityGuard(const AffinityGuard&) = delete;
+        AffinityGuard& operator=(const AffinityGuard&) = delete;
+
+        ~AffinityGuard() {
+          if(!active)
+            return;
+
+#if defined(__linux__)
+          if(saved)
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+
+          bind_memory(-1);
+          placed_cpu() = -1;
+        }
+
+      private:
+        bool active; /* true if the affinity is restored */
+#if defined(__linux__)
+        bool saved = false; /* true if the affinity was saved */
+        cpu_set_t set; /* Saved affinity */
+#endif
+    };
+
+    /*
+     * Returns the CPU the calling thread runs on.
+     *
+     * Return value: The CPU, -1 if unknown
+     */
+    inline int current_cpu() {
+#if defined(__linux__)
+      return sched_getcpu();
+#else
+      return -1;
+#endif
+    }
+  }
+
+  /*
+   * Machine state that affects the timings: frequency scaling, SMT, load and
+   * CPU isolation. The state is read from /sys and /proc on Linux; elsewhere
+   * it is unknown and considered quiet.
+   */
+  struct Environment {
+    unsigned cpus = 0; /* Number of online CPUs */
+    unsigned nodes = 0; /* Number of NUMA nodes */
+    std::string model; /* CPU model name, empty if unknown */
+    std::string governors; /* Frequency scaling governors in use, comma separated, empty if unknown */
+    int boost = -1; /* 1 if frequency boost (turbo) is enabled, 0 if disabled, -1 if unknown */
+    int smt = -1; /* 1 if SMT is active, 0 if not, -1 if unknown */
+    std::string busy_siblings; /* Busy SMT siblings of the CPUs the calling thread may run on, as a CPU list */
+    double load = -1.0; /* One minute load average, negative if unknown */
+    int running = -1; /* Number of other threads ready to run, -1 if unknown */
+    std::string isolated; /* Isolated CPUs (isolcpus), as a CPU list */
+    bool on_isolated = false; /* true if the calling thread may only run on isolated CPUs */
+    std::string compiler; /* Compiler version */
+
+    /*
+     * Returns the reasons the timings taken in this environment are not
+     * reliable.
+     *
+     * Return value: The warnings, empty if the environment is quiet
+     */
+    std::vector<std::string> warnings() const {
+      std::vector<std::string> list;
+
+      if(!governors.empty() && governors != "performance")
+        list.push_back("CPU frequency governor is " + governors + ", not performance");
+
+      if(boost == 1)
+        list.push_back("CPU frequency boost is enabled");
+
+      if(!busy_siblings.empty())
+        list.push_back("SMT siblings " + busy_siblings + " of the CPUs the tests run on are busy and share their cores");
+
+      /* The process running the tests accounts for one */
+      if(load > 1.0 + 0.5 * cpus || running >= static_cast<int>(cpus)) {
+        std::ostringstream ss;
+
+        ss << "Load average is " << load << " with " << running << " other threads running on " << cpus << " CPUs";
+        list.push_back(ss.str());
+      }
+
+      if(!isolated.empty() && !on_isolated)
+        list.push_back("The tests are not confined to the isolated CPUs " + isolated);
+
+      return list;
+    }
+
+    /*
+     * Checks whether the timings taken in this environment are reliable.
+     *
+     * Return value: true if there are no warnings, false if not
+     */
+    bool quiet() const { return warnings().empty(); }
+
+    /*
+     * Returns the state of the machine, read by the first call of the process
+     * (see detect()) and cached, since reading it takes time.
+     *
+     * Return value: The environment
+     */
+    static const Environment& get() {
+      static const Environment env = detect();
+
+      return env;
+    }
+
+    /*
+     * Reads the state of the machine, as seen by the calling thread.
+     *
+     * Return value: The environment
+     */
+    static Environment detect() {
+      Environment env;
+      const std::vector<std::vector<int>>& nodes = detail::Topology::get().get_nodes();
+
+      env.nodes = nodes.size();
+
+      for(size_t n = 0; n < nodes.size(); n++)
+        env.cpus += nodes[n].size();
+
+#if defined(__VERSION__)
+      env.compiler = __VERSION__;
+#endif /* __VERSION__ */
+
+#if defined(__linux__)
+      char buffer[4096];
+      const char* line;
+
+      if(detail::read_proc("/proc/cpuinfo", buffer, sizeof(buffer)) && (line = std::strstr(buffer, "model name")) && (line = std::strchr(line, ':'))) {
+        line += 1 + std::strspn(line + 1, " \t");
+        env.model.assign(line, std::strcspn(line, "\n"));
+      }
+
+      for(size_t n = 0; n < nodes.size(); n++)
+        for(size_t c = 0; c < nodes[n].size(); c++) {
+          std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(nodes[n][c]) + "/cpufreq/scaling_governor";
+
+          if(detail::read_proc(path.c_str(), buffer, sizeof(buffer))) {
+            std::string governor(buffer, std::strcspn(buffer, "\n"));
+
+            if(("," + env.governors + ",").find("," + governor + ",") == std::string::npos)
+              env.governors += (env.governors.empty()? "": ",") + governor;
+          }
+        }
+
+      /* acpi-cpufreq exposes the boost state, intel_pstate its inverse */
+      if(detail::read_proc("/sys/devices/system/cpu/cpufreq/boost", buffer, sizeof(buffer)))
+        env.boost = buffer[0] == '1'? 1: 0;
+      else if(detail::read_proc("/sys/devices/system/cpu/intel_pstate/no_turbo", buffer, sizeof(buffer)))
+        env.boost = buffer[0] == '0'? 1: 0;
+
+      if(detail::read_proc("/sys/devices/system/cpu/smt/active", buffer, sizeof(buffer)))
+        env.smt = buffer[0] == '1'? 1: 0;
+
+      cpu_set_t allowed;
+
+      /* Idle siblings do not slow their cores down: only report those more than a quarter busy over a short window */
+      if(env.smt != 0 && !pthread_getaffinity_np(pthread_self(), sizeof(allowed), &allowed)) {
+        std::vector<int> siblings;
+
+        for(int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+          std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list";
+          std::vector<int> list;
+
+          if(!CPU_ISSET(cpu, &allowed) || !detail::read_proc(path.c_str(), buffer, sizeof(buffer)))
+            continue;
+
+          list = detail::parse_cpu_list(buffer);
+
+          for(size_t t = 0; t < list.size(); t++)
+            if(list[t] != cpu && std::find(siblings.begin(), siblings.end(), list[t]) == siblings.end())
+              siblings.push_back(list[t]);
+        }
+
+        if(!siblings.empty()) {
+          std::map<int, std::pair<unsigned long long, unsigned long long>> before = detail::cpu_times(), after;
+
+          std::this_thread::sleep_for(std::chrono::milliseconds(20));
+          after = detail::cpu_times();
+          std::sort(siblings.begin(), siblings.end());
+
+          for(size_t t = 0; t < siblings.size(); t++) {
+            unsigned long long busy = after[siblings[t]].first - before[siblings[t]].first, total = after[siblings[t]].second - before[siblings[t]].second;
+
+            if(total && 4 * busy > total)
+              env.busy_siblings += (env.busy_siblings.empty()? "": ",") + std::to_string(siblings[t]);
+          }
+        }
+      }
+
+      /* Such as "0.66 0.53 0.47 2/71 12376", the calling thread being one of the 2 running */
+      if(detail::read_proc("/proc/loadavg", buffer, sizeof(buffer)) && std::sscanf(buffer, "%lf %*f %*f %d", &env.load, &env.running) == 2)
+        env.running--;
+
+      if(detail::read_proc("/sys/devices/system/cpu/isolated", buffer, sizeof(buffer))) {
+        std::vector<int> isolated = detail::parse_cpu_list(buffer);
+        cpu_set_t set;
+
+        env.isolated.assign(buffer, std::strcspn(buffer, "\n"));
+        env.on_isolated = !isolated.empty() && !pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+
+        for(int cpu = 0; env.on_isolated && cpu < CPU_SETSIZE; cpu++)
+          if(CPU_ISSET(cpu, &set) && std::find(isolated.begin(), isolated.end(), cpu) == isolated.end())
+            env.on_isolated = false;
+      }
+#endif /* __linux__ */
+
+      return env;
+    }
+  };
+
+  /*
+   * Asymptotic complexity classes, from the lowest to the highest.
+   */
+  enum class Complexity { O_1, O_LOG_N, O_N, O_N_LOG_N, O_N_SQUARED };
+
+  /*
+   * Fit of a set of measured times to a complexity class.
+   */
+  struct ComplexityFit {
+    Complexity complexity = Complexity::O_1; /* Complexity class */
+    double coefficient = 0.0; /* Coefficient of the class function, in seconds */
+    double rms = 0.0; /* Root mean square error, relative to the mean time */
+
+    /*
+     * Returns the name of a complexity class.
+     *
+     * complexity: The complexity class
+     *
+     * Return value: The class name, such as "O(n log n)"
+     */
+    static const char* name(Complexity complexity) {
+      static const char* names[] = { "O(1)", "O(log n)", "O(n)", "O(n log n)", "O(n^2)" };
+
+      return names[static_cast<int>(complexity)];
+    }
+
+    /*
+     * Evaluates the function of a complexity class.
+     *
+     * complexity: The complexity class
+     * n: The input size
+     *
+     * Return value: The function value
+     */
+    static double evaluate(Complexity complexity, double n) {
+      switch(complexity) {
+        case Complexity::O_1: return 1.0;
+        case Complexity::O_LOG_N: return std::log2(std::max(n, 1.0));
+        case Complexity::O_N: return n;
+        case Complexity::O_N_LOG_N: return n * std::log2(std::max(n, 1.0));
+        default: return n * n;
+      }
+    }
+
+    /*
+     * Fits measured times to a complexity class by least squares.
+     *
+     * samples: The input sizes and their times
+     * complexity: The complexity class
+     *
+     * Return value: The fit
+     */
+    static ComplexityFit fit(const std::vector<std::pair<double, double>>& samples, Complexity complexity) {
+      ComplexityFit result;
+      double gg = 0.0, tg = 0.0, mean = 0.0, error = 0.0;
+
+      result.complexity = complexity;
+
+      for(size_t t = 0; t < samples.size(); t++) {
+        double g = evaluate(complexity, samples[t].first);
+
+        gg += g * g;
+        tg += samples[t].second * g;
+        mean += samples[t].second;
+      }
+
+      if(samples.empty() || gg == 0.0)
+        return result;
+
+      result.coefficient = tg / gg;
+      mean /= samples.size();
+
+      for(size_t t = 0; t < samples.size(); t++) {
+        double d = samples[t].second - result.coefficient * evaluate(complexity, samples[t].first);
+
+        error += d * d;
+      }
+
+      result.rms = mean > 0.0? std::sqrt(error / samples.size()) / mean: 0.0;
+
+      return result;
+    }
+
+    /*
+     * Fits measured times to the complexity class that explains them best.
+     *
+     * samples: The input sizes and their times
+     *
+     * Return value: The fit with the lowest error
+     */
+    static ComplexityFit fit(const std::vector<std::pair<double, double>>& samples) {
+      ComplexityFit best = fit(samples, Complexity::O_1);
+
+      for(int c = static_cast<int>(Complexity::O_LOG_N); c <= static_cast<int>(Complexity::O_N_SQUARED); c++) {
+        ComplexityFit candidate = fit(samples, static_cast<Complexity>(c));
+
+        if(candidate.rms < best.rms)
+          best = candidate;
+      }
+
+      return best;
+    }
+  };
+
+  /*
+   * Benchmark state, passed to the benchmark functions. A benchmark function
+   * repeats the code to measure while keep_running() returns true:
+   *
+   *   void bench_sort(Benchmark& state) {
+   *     while(state.keep_running()) {
+   *       std::vector<int> v(input);
+   *
+   *       std::sort(v.begin(), v.end());
+   *       do_not_optimize(v.data());
+   *     }
+   *   }
+   *
+   * The function is called with a growing number of iterations until the
+   * measured time reaches BenchmarkConfig::min_time. Only the loop is timed,
+   * so the code before and after it can prepare and check the data.
+   *
+   * Benchmarks registered over argument ranges read their arguments through
+   * range(), e.g. to size their input.
+   *
+   * Benchmarks run on several threads (see BenchmarkConfig::threads) call the
+   * benchmark function on each thread with the same fixture; the loops start
+   * together and each thread is timed on its own. thread_index() tells the
+   * threads apart, e.g. to split the work or to set up per-thread data.
+   */
+  class Benchmark {
+    public:
+      /*
+       * Initializes a new instance of this class.
+       *
+       * iterations: The number of iterations to run
+       * args: The benchmark arguments
+       * cold: true to flush the caches before each iteration, untimed
+       */
+      explicit Benchmark(size_t iterations, const std::vector<long long>& args = std::vector<long long>(), bool cold = false): iterations(iterations),
+        remaining(iterations), started(false), stopped(false), cold(cold), time(0.0), start(0), args(args), complexity_n(args.empty()? 0: args[0]), index(0),
+        threads(1), barrier(nullptr) {}
+
+      /*
+       * Initializes a new instance of this class for a thread of a multi-threaded
+       * benchmark.
+       *
+       * iterations: The number of iterations to run
+       * args: The benchmark arguments
+       * index: The thread index
+       * threads: The number of threads
+       * barrier: The barrier the threads start their loops at
+       * cold: true to flush the caches before each iteration, untimed
+       */
+      Benchmark(size_t iterations, const std::vector<long long>& args, unsigned index, unsigned threads, detail::Barrier* barrier, bool cold = false):
+        iterations(iterations), remaining(iterations), started(false), stopped(false), cold(cold), time(0.0), start(0), args(args),
+        complexity_n(args.empty()? 0: args[0]), index(index), threads(threads), barrier(barrier) {}
+
+      /*
+       * Checks whether to run another iteration. The first call starts the
+       * timer and the last one stops it.
+       *
+       * Return value: true to run another iteration, false to stop
+       */
+      inline bool keep_running() {
+        if(remaining && started && !cold) {
+          remaining--;
+
+          return true;
+        }
+
+        return advance();
+      }
+
+      /*
+       * Returns the number of iterations to run.
+       *
+       * Return value: The number of iterations
+       */
+      size_t get_iterations() const { return iterations; }
+
+      /*
+       * Returns the time measured by the loop.
+       *
+       * Return value: The measured time in seconds
+       */
+      double get_time() const { return time; }
+
+      /*
+       * Returns an argument of the benchmark.
+       *
+       * index: The argument index
+       *
+       * Return value: The argument
+       */
+      long long range(size_t index = 0) const { return args.at(index); }
+
+      /*
+       * Sets the input size the measured time is fitted against when fitting the
+       * benchmark to a complexity class. It defaults to the first argument.
+       *
+       * n: The input size
+       */
+      void set_complexity_n(long long n) { complexity_n = n; }
+
+      /*
+       * Returns the input size the measured time is fitted against.
+       *
+       * Return value: The input size
+       */
+      long long get_complexity_n() const { return complexity_n; }
+
+      /*
+       * Returns the index of the thread running the benchmark.
+       *
+       * Return value: The thread index, from 0 to get_threads() - 1
+       */
+      unsigned thread_index() const { return index; }
+
+      /*
+       * Returns the number of threads running the benchmark.
+       *
+       * Return value: The number of threads
+       */
+      unsigned get_threads() const { return threads; }
+
+      /*
+       * Checks whether the loop has been started.
+       *
+       * Return value: true once keep_running() has been called
+       */
+      bool is_started() const { return started; }
+
+      /*
+       * Declares the bytes processed by the whole loop, to report the byte rate.
+       *
+       * bytes: The number of bytes
+       */
+      void set_bytes_processed(double bytes) {
+        if(detail::BenchmarkState<>::counters)
+          detail::BenchmarkState<>::counters->bytes = bytes;
+      }
+
+      /*
+       * Declares the items processed by the whole loop, to report the item rate.
+       *
+       * items: The number of items
+       */
+      void set_items_processed(double items) {
+        if(detail::BenchmarkState<>::counters)
+          detail::BenchmarkState<>::counters->items = items;
+      }
+
+      /*
+       * Sets a user counter, accumulated over the whole loop.
+       *
+       * name: The counter name
+       * value: The counter value
+       * kind: How the value is reported
+       */
+      void set_counter(const std::string& name, double value, CounterKind kind = CounterKind::TOTAL) {
+        if(detail::BenchmarkState<>::counters)
+          detail::BenchmarkState<>::counters->set(name, value, kind);
+      }
+
+      /*
+       * Returns the latency histogram of an operation of the benchmark, shared
+       * by all its threads. It gathers the values recorded by all the measured
+       * loops; those of the first, warmup and cold iterations are discarded.
+       *
+       * name: The operation name
+       *
+       * Return value: The histogram
+       */
+      LatencyHistogram& latency(const std::string& name) { return detail::BenchmarkState<>::latency(name); }
+
+    private:
+      /*
+       * Starts the timer before the first iteration and stops it after the last.
+       * With cold caches, the timer is also paused between the iterations to
+       * flush the caches.
+       *
+       * Return value: true to run another iteration, false to stop
+       */
+      bool advance() {
+        if(!started) {
+          started = true;
+
+          if(barrier && !barrier->wait()) {
+            stopped = true;
+
+            return false;
+          }
+
+          if(cold)
+            flush_cache();
+
+          clobber_memory();
+          start = Timer::start();
+
+          if(remaining) {
+            remaining--;
+
+            return true;
+          }
+        }
+
+        Timer::Ticks stop = Timer::stop();
+
+        clobber_memory();
+
+        if(stopped)
+          return false;
+
+        time += Timer::elapsed(start, stop);
+
+        /* Only reached between the iterations with cold caches */
+        if(remaining) {
+          remaining--;
+          flush_cache();
+          start = Timer::start();
+
+          return true;
+        }
+
+        stopped = true;
+
+        return false;
+      }
+
+      size_t iterations; /* Number of iterations to run */
+      size_t remaining; /* Number of iterations left */
+      bool started; /* true once the timer is started */
+      bool stopped; /* true once the timer is stopped for good */
+      bool cold; /* true to flush the caches before each iteration */
+      double time; /* Measured time in seconds */
+      Timer::Ticks start; /* Loop start time */
+      std::vector<long long> args; /* Benchmark arguments */
+      long long complexity_n; /* Input size for complexity fitting */
+      unsigned index; /* Thread index */
+      unsigned threads; /* Number of threads */
+      detail::Barrier* barrier; /* Loop start barrier, nullptr for single-threaded benchmarks */
+  };
+
+  namespace detail {
+    /*
+     * Runs a benchmark function once on a number of threads, each running the
+     * given iterations. The counters the threads declare are summed into the
+     * counters of the calling thread, and the resources they use into those of
+     * the benchmark threads of the running test.
+     *
+     * func: The benchmark function, taking a Benchmark
+     * config: The benchmark configuration
+     * args: The benchmark arguments
+     * iterations: The number of iterations per thread
+     * threads: The number of threads
+     * cold: true to flush the caches before each iteration
+     *
+     * Return value: The mean time of the threads, in seconds
+     */
+    template<typename F> double run_threads(F& func, const BenchmarkConfig& config, const std::vector<long long>& args, size_t iterations, unsigned threads,
+      bool cold = false) {
+      std::vector<double> times(threads);
+      std::vector<Counters> counters(threads);
+      std::vector<ResourceUsage> usages(threads);
+      std::vector<std::thread> workers;
+      std::exception_ptr error;
+      std::mutex error_mutex;
+      Barrier barrier(threads);
+      double total = 0.0;
+      Counters* sum = BenchmarkState<>::counters;
+      LatencyTable* latencies = BenchmarkState<>::latencies;
+
+      for(unsigned t = 0; t < threads; t++) {
+        workers.push_back(std::thread([&, t] () {
+          Benchmark state(iterations, args, t, threads, &barrier, cold);
+          ResourceUsage usage = ResourceUsage::thread();
+
+          if(!config.cpus.empty())
+            pin_thread(config.cpus[t % config.cpus.size()]);
+          else
+            place_thread(config.placement, t, true);
+
+          BenchmarkState<>::counters = &counters[t];
+          BenchmarkState<>::latencies = latencies;
+
+          try {
+            func(state);
+          } catch(...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+
+            if(!error)
+              error = std::current_exception();
+          }
+
+          /* Do not leave the other threads waiting for a loop that never starts */
+          if(!state.is_started())
+            barrier.cancel();
+
+          times[t] = state.get_time();
+          usages[t] = ResourceUsage::thread() - usage;
+        }));
+      }
+
+      for(unsigned t = 0; t < threads; t++)
+        workers[t].join();
+
+      if(error)
+        std::rethrow_exception(error);
+
+      for(unsigned t = 0; t < threads; t++) {
+        total += times[t];
+
+#ifdef RUSAGE_THREAD
+        /* Without per-thread usage, the usage of the calling thread is that of the process and already counts them */
+        if(BenchmarkState<>::workers)
+          *BenchmarkState<>::workers += usages[t];
+#endif /* RUSAGE_THREAD */
+
+        if(sum) {
+          sum->bytes += counters[t].bytes;
+          sum->items += counters[t].items;
+
+          for(size_t c = 0; c < counters[t].user.size(); c++) {
+            size_t u = 0;
+
+            while(u < sum->user.size() && sum->user[u].first != counters[t].user[c].first)
+              u++;
+
+            if(u == sum->user.size())
+              sum->user.push_back(std::make_pair(counters[t].user[c].first, std::make_pair(0.0, counters[t].user[c].second.second)));
+
+            sum->user[u].second.first += counters[t].user[c].second.first;
+          }
+        }
+      }
+
+      return total / threads;
+    }
+
+    /*
+     * Runs a benchmark function once, discarding its counters and latencies.
+     *
+     * func: The benchmark function, taking a Benchmark
+     * config: The benchmark configuration
+     * args: The benchmark arguments
+     * iterations: The number of iterations
+     * threads: The number of threads to run the function on, 0 to run it on the calling thread
+     * cold: true to flush the caches before each iteration
+     *
+     * Return value: The measured time in seconds
+     */
+    template<typename F> double run_aside(F& func, const BenchmarkConfig& config, const std::vector<long long>& args, size_t iterations, unsigned threads,
+      bool cold) {
+      Counters* counters = BenchmarkState<>::counters;
+      Counters saved = counters? *counters: Counters();
+      LatencyTable* latencies = BenchmarkState<>::latencies;
+      double time;
+
+      BenchmarkState<>::latencies = nullptr;
+
+      if(threads)
+        time = run_threads(func, config, args, iterations, threads, cold);
+      else {
+        Benchmark state(iterations, args, cold);
+
+        func(state);
+        time = state.get_time();
+      }
+
+      if(counters)
+        *counters = saved;
+
+      BenchmarkState<>::latencies = latencies;
+
+      return time;
+    }
+
+    /*
+     * Runs a benchmark function with a growing number of iterations until the
+     * measured time is long enough.
+     *
+     * A single iteration is run and timed first, with whatever the state of
+     * the caches, then the warmup iterations, then the measured ones, and
+     * finally the cold iterations, if any.
+     *
+     * func: The benchmark function, taking a Benchmark
+     * config: The benchmark configuration
+     * args: The benchmark arguments
+     * threads: The number of threads to run the function on, 0 to run it on the calling thread
+     *
+     * Return value: The result of the last call
+     */
+    template<typename F> BenchmarkResult measure(F func, const BenchmarkConfig& config, const std::vector<long long>& args, unsigned threads = 0) {
+      BenchmarkResult result;
+      size_t iterations = std::max<size_t>(config.min_iterations, 1);
+
+      result.threads = std::max(threads, 1u);
+      result.complexity_n = args.empty()? 0: args[0];
+      result.first_time = run_aside(func, config, args, 1, threads, false);
+
+      if(config.warmup_iterations)
+        run_aside(func, config, args, config.warmup_iterations, threads, false);
+
+      for(;;) {
+        if(threads) {
+          if(BenchmarkState<>::counters)
+            *BenchmarkState<>::counters = Counters();
+
+          result.time = run_threads(func, config, args, iterations, threads);
+        } else {
+          Benchmark state(iterations, args);
+
+          func(state);
+
+          result.time = state.get_time();
+          result.complexity_n = state.get_complexity_n();
+        }
+
+        result.iterations = iterations;
+
+        if(result.time >= config.min_time || iterations >= config.max_iterations)
+          break;
+
+        /* Aim past the minimum time, growing by at most 10 times per step */
+        iterations = std::min<size_t>(std::min<double>(result.time > 0.0? iterations * 1.4 * config.min_time / result.time: HUGE_VAL, iterations * 10.0) + 1, config.max_iterations);
+      }
+
+      if(config.cold_iterations) {
+        result.cold_iterations = config.cold_iterations;
+        result.cold_time = run_aside(func, config, args, config.cold_iterations, threads, true);
+      }
+
+      return result;
+    }
+  }
+
+  /*
+   * Configuration of the comparison of the speed of two functions (see
+   * Assert::assert_faster_than()).
+   */
+  struct ComparisonConfig {
+    size_t samples = 30; /* Number of timed samples of each function */
+    double min_sample_time = 0.001; /* Minimum time of a sample in seconds, the calls are batched until it is reached */
+    double confidence = 0.99; /* Confidence required to call a difference significant */
+    double tolerance = 1.0; /* Factor the candidate may be slower than the reference by */
+  };
+
+  /*
+   * Outcome of the comparison of the speed of two functions.
+   */
+  struct Comparison {
+    double candidate = 0.0; /* Median time of a call of the candidate in seconds */
+    double reference = 0.0; /* Median time of a call of the reference in seconds */
+    double z = 0.0; /* Mann-Whitney statistic, positive when the candidate is slower */
+    double p = 1.0; /* One-sided p-value of the candidate being slower than the tolerance allows */
+
+    /*
+     * Returns the ratio of the median times.
+     *
+     * Return value: The candidate time over the reference time
+     */
+    double ratio() const { return reference > 0.0? candidate / reference: 0.0; }
+  };
+
+  namespace detail {
+    /*
+     * Returns the median of a set of values.
+     *
+     * values: The values, reordered
+     *
+     * Return value: The median, 0 if there are no values
+     */
+    inline double median(std::vector<double>& values) {
+      size_t n = values.size();
+
+      if(!n)
+        return 0.0;
+
+      std::nth_element(values.begin(), values.begin() + n / 2, values.end());
+
+      if(n % 2)
+        return values[n / 2];
+
+      return 0.5 * (values[n / 2] + *std::max_element(values.begin(), values.begin() + n / 2));
+    }
+
+    /*
+     * Times a batch of calls of a function.
+     *
+     * func: The function
+     * calls: The number of calls
+     *
+     * Return value: The time of a call in seconds
+     */
+    template<typename F> double time_calls(F& func, size_t calls) {
+      Timer::Ticks t1, t2;
+
+      clobber_memory();
+      t1 = Timer::start();
+
+      for(size_t t = 0; t < calls; t++) {
+        func();
+        clobber_memory();
+      }
+
+      t2 = Timer::stop();
+
+      return Timer::elapsed(t1, t2) / calls;
+    }
+
+    /*
+     * Compares the speed of two functions. The functions are timed in
+     * alternating samples, so that a drift of the machine speed affects both,
+     * and the samples are compared with a one-sided Mann-Whitney U test, which
+     * holds for any distribution of the times.
+     *
+     * candidate: The candidate function
+     * reference: The reference function
+     * config: The comparison configuration
+     *
+     * Return value: The comparison
+     */
+    template<typename F, typename G> Comparison compare(F& candidate, G& reference, const ComparisonConfig& config) {
+      Comparison result;
+      size_t n = std::max<size_t>(config.samples, 2), calls;
+      std::vector<double> a(n), b(n);
+      std::vector<std::pair<double, int>> all;
+      double rank_sum = 0.0, slowest = std::max(time_calls(candidate, 1), time_calls(reference, 1));
+
+      calls = slowest > 0.0? std::max<size_t>(static_cast<size_t>(config.min_sample_time / slowest), 1): 1;
+
+      for(size_t s = 0; s < n; s++) {
+        if(s % 2) {
+          b[s] = time_calls(reference, calls);
+          a[s] = time_calls(candidate, calls);
+        } else {
+          a[s] = time_calls(candidate, calls);
+          b[s] = time_calls(reference, calls);
+        }
+
+        all.push_back(std::make_pair(a[s], 0));
+        all.push_back(std::make_pair(b[s] * config.tolerance, 1));
+      }
+
+      /* Ranks, with ties sharing their mean rank */
+      std::sort(all.begin(), all.end());
+
+      for(size_t first = 0, last; first < all.size(); first = last) {
+        for(last = first; last < all.size() && all[last].first == all[first].first; last++);
+
+        for(size_t t = first; t < last; t++)
+          if(!all[t].second)
+            rank_sum += 0.5 * (first + last + 1);
+      }
+
+      result.z = (rank_sum - n * (n + 1) / 2.0 - n * n / 2.0) / std::sqrt(n * n * (2.0 * n + 1) / 12.0);
+      result.p = 0.5 * std::erfc(result.z / std::sqrt(2.0));
+      result.candidate = median(a);
+      result.reference = median(b);
+
+      return result;
+    }
+  }
+
+  /*
+   * Value generators for property based testing.
+   *
+   * A generator defines the value_type it generates and the functions:
+   *
+   *   value_type generate(std::mt19937_64& rng, size_t size) const;
+   *   std::vector<value_type> shrink(const value_type& value) const;
+   *
+   * generate() returns a random value whose complexity grows with size, and
+   * shrink() returns simpler candidates for a value, simplest first.
+   * Generators must be usable from multiple threads at once.
+   */
+  namespace gen {
+    /*
+     * Integral value generator.
+     *
+     * V: The integral type
+     */
+    template<typename V> class Integral {
+      public:
+        typedef V value_type;
+
+        /*
+         * Initializes a new generator.
+         *
+         * min: The minimum value (inclusive)
+         * max: The maximum value (inclusive)
+         */
+        Integral(V min = std::numeric_limits<V>::min(), V max = std::numeric_limits<V>::max()): min(min), max(max) {}
+
+        V generate(std::mt19937_64& rng, size_t size) const {
+          switch(rng() % 8) {
+            case 0: return min;
+            case 1: return max;
+            case 2: case 3: return uniform(rng, min, max);
+            default: {
+              /* Small values around the origin */
+              V o = origin();
+              V below = static_cast<V>(std::min<std::uintmax_t>(size, static_cast<std::uintmax_t>(o) - static_cast<std::uintmax_t>(min)));
+              V above = static_cast<V>(std::min<std::uintmax_t>(size, static_cast<std::uintmax_t>(max) - static_cast<std::uintmax_t>(o)));
+
+              return uniform(rng, static_cast<V>(o - below), static_cast<V>(o + above));
+            }
+          }
+        }
+
+        std::vector<V> shrink(const V& value) const {
+          typedef typename std::make_unsigned<V>::type U;
+          std::vector<V> candidates;
+          V o = origin();
+
+          if(value == o)
+            return candidates;
+
+          candidates.push_back(o);
+
+          /* Move towards the origin by halving distances, computed unsigned as they may exceed the range of V */
+          for(U d = static_cast<U>(value > o? U(value) - U(o): U(o) - U(value)) / 2; d > 0; d /= 2)
+            candidates.push_back(static_cast<V>(value > o? static_cast<U>(U(value) - d): static_cast<U>(U(value) + d)));
+
+          return candidates;
+        }
+
+      private:
+        /* Returns the simplest value in range: the one closest to 0 */
+        V origin() const { return min > V(0)? min: max < V(0)? max: V(0); }
+
+        /* Draws a uniform value, widening the types std::uniform_int_distribution does not support */
+        static V uniform(std::mt19937_64& rng, V lo, V hi) {
+          typedef typename std::conditional<(sizeof(V) < sizeof(int)), typename std::conditional<std::is_signed<V>::value, int, unsigned>::type, V>::type D;
+
+          return static_cast<V>(std::uniform_int_distribution<D>(lo, hi)(rng));
+        }
+
+        V min; /* Minimum value */
+        V max; /* Maximum value */
+    };
+
+    /*
+     * Floating point value generator.
+     *
+     * V: The floating point type
+     */
+    template<typename V> class Floating {
+      public:
+        typedef V value_type;
+
+        /*
+         * Initializes a new generator.
+         *
+         * min: The minimum value (inclusive)
+         * max: The maximum value (inclusive)
+         */
+        Floating(V min = V(-1e6), V max = V(1e6)): min(min), max(max) {}
+
+        V generate(std::mt19937_64& rng, size_t size) const {
+          switch(rng() % 8) {
+            case 0: return min;
+            case 1: return max;
+            case 2: return clamp(V(0));
+            case 3: case 4: return uniform(rng);
+            default: return clamp(std::uniform_real_distribution<V>(-V(size), V(size))(rng));
+          }
+        }
+
+        std::vector<V> shrink(const V& value) const {
+          std::vector<V> candidates;
+          V o = clamp(V(0));
+
+          if(value == o || value != value)
+            return candidates;
+
+          candidates.push_back(o);
+
+          if(clamp(std::trunc(value)) != value)
+            candidates.push_back(clamp(std::trunc(value)));
+
+          if(clamp(value / 2) != value)
+            candidates.push_back(clamp(value / 2));
+
+          return candidates;
+        }
+
+      private:
+        V clamp(V v) const { return v < min? min: v > max? max: v; }
+
+        /* Draws a uniform value in range; std::uniform_real_distribution needs max - min to be finite */
+        V uniform(std::mt19937_64& rng) const {
+          if(max - min <= std::numeric_limits<V>::max())
+            return std::uniform_real_distribution<V>(min, max)(rng);
+
+          return clamp(2 * std::uniform_real_distribution<V>(min / 2, max / 2)(rng));
+        }
+
+        V min; /* Minimum value */
+        V max; /* Maximum value */
+    };
+
+    /*
+     * Container generator, producing vectors of values from an element generator.
+     *
+     * G: The element generator type
+     */
+    template<typename G> class Vector {
+      public:
+        typedef std::vector<typename G::value_type> value_type;
+
+        /*
+         * Initializes a new generator.
+         *
+         * element: The element generator
+         * max_length: The maximum length, 0 to bound the length by the size only
+         */
+        Vector(const G& element = G(), size_t max_length = 0): element(element), max_length(max_length) {}
+
+        value_type generate(std::mt19937_64& rng, size_t size) const {
+          size_t bound = max_length && max_length < size? max_length: size;
+          value_type value(std::uniform_int_distribution<size_t>(0, bound)(rng));
+
+          for(typename value_type::iterator it = value.begin(); it != value.end(); it++)
+            *it = element.generate(rng, size);
+
+          return value;
+        }
+
+        std::vector<value_type> shrink(const value_type& value) const {
+          std::vector<value_type> candidates;
+
+          if(value.empty())
+            return candidates;
+
+          candidates.push_back(value_type());
+
+          /* Remove chunks of decreasing length */
+          for(size_t len = value.size() / 2; len > 0; len /= 2)
+            for(size_t pos = 0; pos + len <= value.size(); pos += len) {
+              value_type c(value.begin(), value.begin() + pos);
+
+              c.insert(c.end(), value.begin() + pos + len, value.end());
+              candidates.push_back(c);
+            }
+
+          /* Shrink single elements */
+          for(size_t t = 0; t < value.size(); t++) {
+            std::vector<typename G::value_type> elems = element.shrink(value[t]);
+
+            for(size_t e = 0; e < elems.size(); e++) {
+              value_type c(value);
+
+              c[t] = elems[e];
+              candidates.push_back(c);
+            }
+          }
+
+          return candidates;
+        }
+
+      private:
+        G element; /* Element generator */
+        size_t max_length; /* Maximum length */
+    };
+
+    /*
+     * String generator.
+     */
+    class String {
+      public:
+        typedef std::string value_type;
+
+        /*
+         * Initializes a new generator.
+         *
+         * alphabet: The characters to build the strings from, printable ASCII by default
+         * max_length: The maximum length, 0 to bound the length by the size only
+         */
+        String(const std::string& alphabet = std::string(), size_t max_length = 0): alphabet(alphabet), max_length(max_length) {
+          if(this->alphabet.empty())
+            for(char c = ' '; c <= '~'; c++)
+              this->alphabet += c;
+        }
+
+        std::string generate(std::mt19937_64& rng, size_t size) const {
+          size_t bound = max_length && max_length < size? max_length: size;
+          std::string value(std::uniform_int_distribution<size_t>(0, bound)(rng), ' ');
+
+          for(std::string::iterator it = value.begin(); it != value.end(); it++)
+            *it = alphabet[rng() % alphabet.size()];
+
+          return value;
+        }
+
+        std::vector<std::string> shrink(const std::string& value) const {
+          std::vector<std::string> candidates;
+
+          if(value.empty())
+            return candidates;
+
+          candidates.push_back(std::string());
+
+          /* Remove chunks of decreasing length */
+          for(size_t len = value.size() / 2; len > 0; len /= 2)
+            for(size_t pos = 0; pos + len <= value.size(); pos += len)
+              candidates.push_back(value.substr(0, pos) + value.substr(pos + len));
+
+          /* Replace single characters with the simplest one */
+          for(size_t t = 0; t < value.size(); t++)
+            if(value[t] != alphabet[0]) {
+              std::string c(value);
+
+              c[t] = alphabet[0];
+              candidates.push_back(c);
+            }
+
+          return candidates;
+        }
+
+      private:
+        std::string alphabet; /* Characters */
+        size_t max_length; /* Maximum length */
+    };
+
+    /*
+     * Pair generator, combining two generators.
+     *
+     * A: The generator type of the first element
+     * B: The generator type of the second element
+     */
+    template<typename A, typename B> class Pair {
+      public:
+        typedef std::pair<typename A::value_type, typename B::value_type> value_type;
+
+        /*
+         * Initializes a new generator.
+         *
+         * first: The generator of the first element
+         * second: The generator of the second element
+         */
+        Pair(const A& first = A(), const B& second = B()): first(first), second(second) {}
+
+        value_type generate(std::mt19937_64& rng, size_t size) const {
+          typename A::value_type a = first.generate(rng, size);
+
+          return value_type(a, second.generate(rng, size));
+        }
+
+        std::vector<value_type> shrink(const value_type& value) const {
+          std::vector<value_type> candidates;
+          std::vector<typename A::value_type> as = first.shrink(value.first);
+          std::vector<typename B::value_type> bs = second.shrink(value.second);
+
+          for(size_t t = 0; t < as.size(); t++)
+            candidates.push_back(value_type(as[t], value.second));
+
+          for(size_t t = 0; t < bs.size(); t++)
+            candidates.push_back(value_type(value.first, bs[t]));
+
+          return candidates;
+        }
+
+      private:
+        A first; /* First element generator */
+        B second; /* Second element generator */
+    };
+
+    /*
+     * Default generator for a type. Specializations exist for the integral,
+     * floating point, string, vector and pair types; other types can be
+     * supported by further specializations.
+     *
+     * V: The value type
+     */
+    template<typename V, typename = void> struct Arbitrary;
+
+    template<typename V> struct Arbitrary<V, typename std::enable_if<std::is_integral<V>::value && !std::is_same<V, bool>::value>::type>: Integral<V> {};
+    template<typename V> struct Arbitrary<V, typename std::enable_if<std::is_floating_point<V>::value>::type>: Floating<V> {};
+    template<> struct Arbitrary<std::string>: String {};
+    template<typename E> struct Arbitrary<std::vector<E>>: Vector<Arbitrary<E>> {};
+    template<typename A, typename B> struct Arbitrary<std::pair<A, B>>: Pair<Arbitrary<A>, Arbitrary<B>> {};
+
+    template<> struct Arbitrary<bool> {
+      typedef bool value_type;
+
+      bool generate(std::mt19937_64& rng, size_t) const { return rng() & 1; }
+      std::vector<bool> shrink(const bool& value) const { return value? std::vector<bool>(1, false): std::vector<bool>(); }
+    };
+  }
+
+  /*
+   * Property based test configuration.
+   */
+  struct PropertyConfig {
+    size_t cases = 100; /* Number of random cases */
+    std::uint64_t seed = 0; /* Random seed, 0 for a new seed on each run */
+    unsigned workers = 0; /* Number of threads evaluating the cases, 0 for one per hardware thread */
+    size_t max_size = 100; /* Maximum size passed to the generator, reached by the last case; 0 to always pass 0 */
+    size_t max_shrinks = 1000; /* Maximum number of shrinking steps */
+  };
+
+  /*
+   * Read-only file mapped into memory.
+   *
+   * On POSIX systems the file is memory mapped, elsewhere (or when the file
+   * cannot be mapped) its content is read into memory.
+   */
+  class MappedFile {
+    public:
+      /*
+       * Initializes an empty file.
+       */
+      MappedFile() noexcept: addr(nullptr), len(0), mapped(false) {}
+
+      /*
+       * Maps a file into memory.
+       *
+       * path: The file path
+       *
+       * Throws std::runtime_error if the file cannot be read.
+       */
+      explicit MappedFile(const char* path): addr(nullptr), len(0), mapped(false) {
+#ifdef ENKI_POSIX
+        int fd = ::open(path, O_RDONLY);
+        struct stat st;
+
+        if(fd < 0)
+          throw std::runtime_error(std::string("enki: cannot open ") + path);
+
+        if(::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+          len = static_cast<size_t>(st.st_size);
+
+          if(len) {
+            void* p = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if(p != MAP_FAILED) {
+              addr = static_cast<const unsigned char*>(p);
+              mapped = true;
+            }
+          }
+        }
+
+        ::close(fd);
+
+        if(mapped)
+          return;
+#endif /* ENKI_POSIX */
+        std::ifstream is(path, std::ios::binary);
+
+        if(!is)
+          throw std::runtime_error(std::string("enki: cannot open ") + path);
+
+        buffer.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+        addr = reinterpret_cast<const unsigned char*>(buffer.data());
+        len = buffer.size();
+      }
+
+      MappedFile(MappedFile&& other) noexcept: addr(nullptr), len(0), mapped(false) { swap(other); }
+
+      MappedFile& operator=(MappedFile&& other) noexcept {
+        MappedFile tmp(std::move(other));
+
+        swap(tmp);
+
+        return *this;
+      }
+
+      MappedFile(const MappedFile&) = delete;
+      MappedFile& operator=(const MappedFile&) = delete;
+
+      ~MappedFile() {
+#ifdef ENKI_POSIX
+        if(mapped)
+          ::munmap(const_cast<unsigned char*>(addr), len);
+#endif /* ENKI_POSIX */
+      }
+
+      /*
+       * Returns the file content.
+       *
+       * Return value: A pointer to the first byte of the file
+       */
+      const unsigned char* data() const noexcept { return addr; }
+
+      /*
+       * Returns the file size.
+       *
+       * Return value: The file size in bytes
+       */
+      size_t size() const noexcept { return len; }
+
+      /*
+       * Checks whether the file is memory mapped.
+       *
+       * Return value: true if the file is memory mapped, false if its content was read into memory
+       */
+      bool is_mapped() const noexcept { return mapped; }
+
+      /*
+       * Swaps two mapped files.
+       *
+       * other: The file to swap with
+       */
+      void swap(MappedFile& other) noexcept {
+        std::swap(addr, other.addr);
+        std::swap(len, other.len);
+        std::swap(mapped, other.mapped);
+        buffer.swap(other.buffer); /* Swapping keeps the buffer storage, so addr stays valid */
+      }
+
+    private:
+      const unsigned char* addr; /* File content */
+      size_t len; /* File size */
+      bool mapped; /* true if the file is memory mapped */
+      std::vector<char> buffer; /* File content, when not mapped */
+  };
+
+  namespace detail {
+    /*
+     * Returns the offset of the first difference between two memory blocks.
+     * The blocks are compared by memcmp(), which the C libraries implement
+     * with SIMD code, and only the first differing chunk is scanned byte by
+     * byte.
+     *
+     * a: The first block
+     * b: The second block
+     * size: The size of the blocks
+     *
+     * Return value: The offset of the first differing byte, size if the blocks are equal
+     */
+    inline size_t mismatch(const unsigned char* a, const unsigned char* b, size_t size) {
+      const size_t chunk = 4096;
+      size_t offset = 0;
+
+      while(offset < size && std::memcmp(a + offset, b + offset, std::min(chunk, size - offset)) == 0)
+        offset += chunk;
+
+      while(offset < size && a[offset] == b[offset])
+        offset++;
+
+      return std::min(offset, size);
+    }
+
+    /*
+     * Replaces the content of a file, so that readers see either the old or
+     * the new content: the content is written to a temporary file, which is
+     * then renamed over the file.
+     *
+     * path: The file path
+     * data: The new content
+     * size: The content size
+     *
+     * Return value: true on success, false on failure
+     */
+    inline bool write_atomically(const char* path, const void* data, size_t size) {
+      std::string temp = std::string(path) + ".enki-tmp";
+#ifdef ENKI_POSIX
+      const char* p = static_cast<const char*>(data);
+      int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      bool ok = fd >= 0;
+
+      while(ok && size) {
+        ssize_t n = ::write(fd, p, size);
+
+        if(n < 0 && errno == EINTR)
+          continue;
+
+        ok = n > 0;
+        p += ok? n: 0;
+        size -= ok? n: 0;
+      }
+
+      if(fd >= 0) {
+        ok = ::fsync(fd) == 0 && ok;
+        ok = ::close(fd) == 0 && ok;
+      }
+
+      if(ok && ::rename(temp.c_str(), path) == 0)
+        return true;
+#else
+      std::ofstream os(temp.c_str(), std::ios::binary | std::ios::trunc);
+
+      os.write(static_cast<const char*>(data), size);
+      os.close();
+
+      /* rename() does not replace existing files everywhere */
+      if(os && (std::rename(temp.c_str(), path) == 0 || (std::remove(path) == 0 && std::rename(temp.c_str(), path) == 0)))
+        return true;
+#endif /* ENKI_POSIX */
+      std::remove(temp.c_str());
+
+      return false;
+    }
+
+    /*
+     * Checks whether golden files are to be updated rather than compared
+     * against, which is the case when the ENKI_UPDATE_GOLDEN environment
+     * variable is set to a value other than 0.
+     *
+     * Return value: true to update the golden files, false to compare against them
+     */
+    inline bool update_golden() {
+      const char* env = std::getenv("ENKI_UPDATE_GOLDEN");
+
+      return env && *env && std::strcmp(env, "0");
+    }
+  }
+
+  namespace detail {
+    /*
+     * Multiplies two 64 bit values into 128 bits.
+     *
+     * a: The first value, receiving the low half
+     * b: The second value, receiving the high half
+     */
+    inline void multiply128(std::uint64_t& a, std::uint64_t& b) {
+#if defined(__SIZEOF_INT128__)
+      __extension__ typedef unsigned __int128 uint128;
+      uint128 r = static_cast<uint128>(a) * b;
+
+      a = static_cast<std::uint64_t>(r);
+      b = static_cast<std::uint64_t>(r >> 64);
+#else
+      std::uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<std::uint32_t>(a), lb = static_cast<std::uint32_t>(b);
+      std::uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32), c = t < rl;
+      std::uint64_t lo = t + (rm1 << 32);
+
+      c += lo < t;
+      a = lo;
+      b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif /* __SIZEOF_INT128__ */
+    }
+
+    /*
+     * Mixes two 64 bit values through their 128 bit product.
+     *
+     * Return value: The mixed value
+     */
+    inline std::uint64_t hash_mix(std::uint64_t a, std::uint64_t b) {
+      multiply128(a, b);
+
+      return a ^ b;
+    }
+
+    /* Reads 8 and 4 bytes, in the byte order of the machine */
+    inline std::uint64_t read64(const unsigned char* p) { std::uint64_t v; std::memcpy(&v, p, 8); return v; }
+    inline std::uint64_t read32(const unsigned char* p) { std::uint32_t v; std::memcpy(&v, p, 4); return v; }
+
+    /*
+     * Hashes a memory block with a fast non-cryptographic 64 bit hash, of the
+     * wyhash family: each 16 bytes of input go through a single 64x64 to 128
+     * bit multiplication, which puts it with XXH3 among the fastest quality
+     * hashes. The result depends on the byte order of the machine.
+     *
+     * data: The block
+     * size: The block size
+     * seed: The seed
+     *
+     * Return value: The hash
+     */
+    inline std::uint64_t hash64(const void* data, size_t size, std::uint64_t seed = 0) {
+      static const std::uint64_t secret[4] = { 0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL };
+      const unsigned char* p = static_cast<const unsigned char*>(data);
+      std::uint64_t a, b;
+
+      seed ^= hash_mix(seed ^ secret[0], secret[1]);
+
+      if(size <= 16) {
+        if(size >= 4) {
+          a = (read32(p) << 32) | read32(p + ((size >> 3) << 2));
+          b = (read32(p + size - 4) << 32) | read32(p + size - 4 - ((size >> 3) << 2));
+        } else if(size) {
+          a = (std::uint64_t(p[0]) << 16) | (std::uint64_t(p[size >> 1]) << 8) | p[size - 1];
+          b = 0;
+        } else
+          a = b = 0;
+      } else {
+        size_t left = size;
+
+        if(left > 48) {
+          std::uint64_t seed1 = seed, seed2 = seed;
+
+          do {
+            seed = hash_mix(read64(p) ^ secret[1], read64(p + 8) ^ seed);
+            seed1 = hash_mix(read64(p + 16) ^ secret[2], read64(p + 24) ^ seed1);
+            seed2 = hash_mix(read64(p + 32) ^ secret[3], read64(p + 40) ^ seed2);
+            p += 48;
+            left -= 48;
+          } while(left > 48);
+
+          seed ^= seed1 ^ seed2;
+        }
+
+        while(left > 16) {
+          seed = hash_mix(read64(p) ^ secret[1], read64(p + 8) ^ seed);
+          p += 16;
+          left -= 16;
+        }
+
+        a = read64(p + left - 16);
+        b = read64(p + left - 8);
+      }
+
+      a ^= secret[1];
+      b ^= seed;
+      multiply128(a, b);
+
+      return hash_mix(a ^ secret[0] ^ size, b ^ secret[1]);
+    }
+  }
+
+  /*
+   * Store of the snapshots of a test case, kept in a single file.
+   *
+   * The file is memory mapped once and indexed by snapshot key; a snapshot
+   * is checked by comparing the hash of the new content with the stored one,
+   * so that the stored content is only read when the snapshot differs. New
+   * and updated snapshots are kept in memory until save() rewrites the file.
+   *
+   * The file is made of a header line, "enki-snapshots 1", followed by the
+   * snapshots in key order, each one made of the line
+   * "<hash, 16 hex digits> <content size> <key>" followed by the content and
+   * a newline, so that it can be reviewed as text.
+   *
+   * All the methods are thread safe.
+   */
+  class SnapshotStore {
+    public:
+      /*
+       * Outcomes of the check of a snapshot.
+       */
+      enum class Outcome {
+        MATCHED, /* The content matches the snapshot */
+        RECORDED, /* There was no snapshot, the content is recorded as the snapshot */
+        UPDATED, /* The content differs, and replaces the snapshot */
+        DIFFERS /* The content differs from the snapshot */
+      };
+
+      /*
+       * Opens a snapshot file. A missing file is an empty store.
+       *
+       * path: The file path
+       *
+       * Throws std::runtime_error if the file cannot be read or is not a snapshot file.
+       */
+      explicit SnapshotStore(const char* path): path(path), dirty(false) {
+        static const char header[] = "enki-snapshots 1\n";
+        const char* begin;
+        const char* end;
+
+        try {
+          file = MappedFile(path);
+        } catch(std::runtime_error&) {
+          if(std::ifstream(path))
+            throw;
+
+          return;
+        }
+
+        begin = reinterpret_cast<const char*>(file.data());
+        end = begin + file.size();
+
+        if(begin == end)
+          return;
+
+        if(file.size() < sizeof(header) - 1 || std::memcmp(begin, header, sizeof(header) - 1))
+          throw std::runtime_error(std::string("enki: not a snapshot file: ") + path);
+
+        for(const char* p = begin + sizeof(header) - 1; p < end; ) {
+          const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+          Entry entry;
+          char* field;
+          unsigned long long size;
+
+          if(!eol || eol - p < 19)
+            throw std::runtime_error(std::string("enki: corrupted snapshot file: ") + path);
+
+          entry.hash = std::strtoull(p, &field, 16);
+          size = std::strtoull(field, &field, 10);
+
+          if(*field != ' ' || size >= static_cast<unsigned long long>(end - eol - 1) || eol[1 + size] != '\n')
+            throw std::runtime_error(std::string("enki: corrupted snapshot file: ") + path);
+
+          entry.data = eol + 1;
+          entry.size = static_cast<size_t>(size);
+          entries[std::string(static_cast<const char*>(field) + 1, eol)] = entry;
+          p = eol + 2 + size;
+        }
+      }
+
+      /*
+       * Saves the changes, if any.
+       */
+      ~SnapshotStore() { save(); }
+
+      SnapshotStore(const SnapshotStore&) = delete;
+      SnapshotStore& operator=(const SnapshotStore&) = delete;
+
+      /*
+       * Checks content against its snapshot.
+       *
+       * key: The snapshot key, any string; newlines and backslashes are escaped in the file
+       * content: The content
+       * update: true to replace a differing snapshot with the content
+       * stored: Receives the snapshot content when it differs
+       *
+       * Return value: The outcome
+       */
+      Outcome check(const std::string& key, const std::string& content, bool update, std::string& stored) {
+        std::uint64_t hash = detail::hash64(content.data(), content.size());
+        std::string escaped = escape(key);
+        std::lock_guard<std::mutex> lock(mutex);
+        typename std::map<std::string, Entry>::iterator it = entries.find(escaped);
+        Outcome outcome = Outcome::RECORDED;
+
+        if(it != entries.end()) {
+          if(it->second.hash == hash)
+            return Outcome::MATCHED;
+
+          if(!update) {
+            stored.assign(it->second.data, it->second.size);
+
+            return Outcome::DIFFERS;
+          }
+
+          outcome = Outcome::UPDATED;
+        }
+
+        Entry& entry = entries[escaped];
+
+        entry.hash = hash;
+        entry.content = std::make_shared<std::string>(content);
+        entry.data = entry.content->data();
+        entry.size = entry.content->size();
+        dirty = true;
+
+        return outcome;
+      }
+
+      /*
+       * Rewrites the snapshot file atomically if any snapshot was recorded or
+       * updated since it was opened or last saved.
+       *
+       * Return value: true on success, false if the file could not be written
+       */
+      bool save() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::string out = "enki-snapshots 1\n";
+
+        if(!dirty)
+          return true;
+
+        for(typename std::map<std::string, Entry>::const_iterator it = entries.begin(); it != entries.end(); it++) {
+          char line[48];
+
+          std::snprintf(line, sizeof(line), "%016llx %llu ", static_cast<unsigned long long>(it->second.hash), static_cast<unsigned long long>(it->second.size));
+          out += line;
+          out += it->first;
+          out += '\n';
+          out.append(it->second.data, it->second.size);
+          out += '\n';
+        }
+
+        /* The entries still point into the old mapping, which stays valid after the rename */
+        dirty = !detail::write_atomically(path.c_str(), out.data(), out.size());
+
+        return !dirty;
+      }
+
+      /*
+       * Returns the path of the snapshot file.
+       *
+       * Return value: The file path
+       */
+      const std::string& get_path() const { return path; }
+
+    private:
+      /* Escapes a key to fit on its header line */
+      static std::string escape(const std::string& key) {
+        std::string escaped;
+
+        if(key.find_first_of("\\\n") == std::string::npos)
+          return key;
+
+        for(size_t t = 0; t < key.size(); t++)
+          escaped += key[t] == '\n'? "\\n": key[t] == '\\'? "\\\\": std::string(1, key[t]);
+
+        return escaped;
+      }
+
+      struct Entry {
+        std::uint64_t hash = 0; /* Content hash */
+        const char* data = nullptr; /* Content, in the mapped file or in content */
+        size_t size = 0; /* Content size */
+        std::shared_ptr<std::string> content; /* Content recorded since the file was opened */
+      };
+
+      std::string path; /* File path */
+      MappedFile file; /* Mapped file */
+      std::map<std::string, Entry> entries; /* Snapshots, by key */
+      bool dirty; /* true if there are unsaved changes */
+      mutable std::mutex mutex; /* Access lock */
+  };
+
+  namespace detail {
+    /*
+     * Snapshot context of the test running on each thread.
+     */
+    template<typename D = void> struct SnapshotState {
+      static thread_local SnapshotStore* store; /* Store of the running test, or nullptr */
+      static thread_local std::string name; /* Name of the running test */
+      static thread_local size_t count; /* Number of unnamed snapshots checked by the running test */
+    };
+
+    template<typename D> thread_local SnapshotStore* SnapshotState<D>::store = nullptr;
+    template<typename D> thread_local std::string SnapshotState<D>::name;
+    template<typename D> thread_local size_t SnapshotState<D>::count = 0;
+
+    /*
+     * Checks whether snapshots are to be updated rather than compared
+     * against, which is the case when the ENKI_UPDATE_SNAPSHOTS environment
+     * variable is set to a value other than 0.
+     *
+     * Return value: true to update the snapshots, false to compare against them
+     */
+    inline bool update_snapshots() {
+      const char* env = std::getenv("ENKI_UPDATE_SNAPSHOTS");
+
+      return env && *env && std::strcmp(env, "0");
+    }
+  }
+
+  /*
+   * Tolerance of the comparison of floating point values. Two values are
+   * near each other if they are equal, or if both are finite and at least one
+   * of the tolerances holds:
+   *
+   *   |a - b| <= absolute
+   *   |a - b| <= relative * max(|a|, |b|)
+   *   a and b are at most ulps representable values apart
+   *
+   * NaNs are never near anything.
+   */
+  struct Tolerance {
+    double absolute; /* Absolute tolerance */
+    double relative; /* Tolerance relative to the larger magnitude */
+    std::uint64_t ulps; /* Tolerance in units in the last place */
+
+    /*
+     * Initializes a new tolerance.
+     *
+     * absolute: The absolute tolerance
+     * relative: The relative tolerance
+     * ulps: The tolerance in units in the last place
+     */
+    Tolerance(double absolute = 0.0, double relative = 0.0, std::uint64_t ulps = 0): absolute(absolute), relative(relative), ulps(ulps) {}
+  };
+
+  namespace detail {
+    /*
+     * Integer types of the same size as the floating point types.
+     *
+     * F: float or double
+     */
+    template<typename F> struct FloatBits;
+
+    template<> struct FloatBits<float> {
+      typedef std::int32_t type;
+      typedef std::uint32_t utype;
+    };
+
+    template<> struct FloatBits<double> {
+      typedef std::int64_t type;
+      typedef std::uint64_t utype;
+    };
+
+    /*
+     * Tolerance converted to the type of the compared values, so that the
+     * comparison of arrays runs on lanes of a single width.
+     *
+     * F: float or double
+     */
+    template<typename F> struct LaneTolerance {
+      typedef typename FloatBits<F>::utype utype;
+
+      F absolute; /* Absolute tolerance */
+      F relative; /* Relative tolerance */
+      utype ulps; /* ULP tolerance, saturated to the lane width */
+
+      explicit LaneTolerance(const Tolerance& tolerance): absolute(static_cast<F>(tolerance.absolute)), relative(static_cast<F>(tolerance.relative)),
+        ulps(static_cast<utype>(std::min<std::uint64_t>(tolerance.ulps, std::numeric_limits<utype>::max()))) {}
+    };
+
+    /*
+     * Maps the bits of a floating point value to an integer ordered as the
+     * values are, so that adjacent values differ by 1 and both zeros map to 0.
+     *
+     * value: The value
+     *
+     * Return value: The ordered integer
+     */
+    template<typename F> inline typename FloatBits<F>::type ordered_bits(F value) {
+      typedef typename FloatBits<F>::type itype;
+      typedef typename FloatBits<F>::utype utype;
+      itype bits, mask;
+      utype magnitude;
+
+      std::memcpy(&bits, &value, sizeof(bits));
+      mask = bits >> (sizeof(bits) * 8 - 1);
+      magnitude = static_cast<utype>(bits) & (std::numeric_limits<utype>::max() >> 1);
+
+      return static_cast<itype>((magnitude ^ static_cast<utype>(mask)) - static_cast<utype>(mask));
+    }
+
+    /*
+     * Returns the distance between two values in units in the last place.
+     *
+     * a: The first value
+     * b: The second value
+     *
+     * Return value: The number of representable values between a and b, plus one
+     */
+    template<typename F> inline typename FloatBits<F>::utype ulp_distance(F a, F b) {
+      typedef typename FloatBits<F>::utype utype;
+      typename FloatBits<F>::type x = ordered_bits(a), y = ordered_bits(b);
+
+      return x >= y? static_cast<utype>(x) - static_cast<utype>(y): static_cast<utype>(y) - static_cast<utype>(x);
+    }
+
+    /*
+     * Checks whether two values are near each other, without branches.
+     *
+     * a: The first value
+     * b: The second value
+     * tolerance: The tolerance
+     *
+     * Return value: true if the values are near, false if not
+     */
+    template<typename F> inline bool near(F a, F b, const LaneTolerance<F>& tolerance) {
+      F diff = std::fabs(a - b), magnitude = std::max(std::fabs(a), std::fabs(b));
+
+      return (a == b) | ((diff <= std::numeric_limits<F>::max()) & ((diff <= tolerance.absolute) | (diff <= tolerance.relative * magnitude)
+        | (ulp_distance(a, b) <= tolerance.ulps)));
+    }
+
+    /*
+     * Counts the values of two arrays that are not near each other. The inner
+     * loop has no branches and counts in integers of the width of the values,
+     * so that the compiler turns it into SIMD code; its count is folded into a
+     * size_t every 2^20 values, before the 32 bit count of floats can wrap.
+     *
+     * a: The first array
+     * b: The second array
+     * length: The length of the arrays
+     * tolerance: The tolerance
+     *
+     * Return value: The number of values that are not near
+     */
+    template<typename F> inline size_t count_far(const F* a, const F* b, size_t length, const LaneTolerance<F>& tolerance) {
+      const size_t chunk = size_t(1) << 20;
+      size_t total = 0;
+
+      for(size_t begin = 0; begin < length; begin += chunk) {
+        size_t end = std::min(begin + chunk, length);
+        typename FloatBits<F>::utype far = 0;
+
+        for(size_t t = begin; t < end; t++)
+          far += !near(a[t], b[t], tolerance);
+
+        total += far;
+      }
+
+      return total;
+    }
+  }
+
+  namespace detail {
+    /* Edit of a diff between two sequences */
+    struct DiffEdit {
+      char op; /* ' ' for a common element, '-' for an element of the first sequence only, '+' for one of the second only */
+      size_t a; /* Index into the first sequence, for common elements and removals */
+      size_t b; /* Index into the second sequence, for common elements and insertions */
+    };
+
+    /*
+     * Computes a shortest edit script between two ranges with the Myers
+     * algorithm, in O((n + m) * d) time for d edits.
+     *
+     * a: The first range
+     * n: The length of the first range
+     * b: The second range
+     * m: The length of the second range
+     * max_edits: The maximum number of edits to search for
+     * edits: Receives the edits, with indices relative to the ranges
+     *
+     * Return value: true if the ranges differ by max_edits edits or less, false if not
+     *
+     * I: A random access iterator type
+     * J: A random access iterator type
+     */
+    template<typename I, typename J> bool myers(I a, long n, J b, long m, long max_edits, std::vector<DiffEdit>& edits) {
+      long offset = max_edits + 1;
+      std::vector<long> v(2 * offset + 1, 0);
+      std::vector<std::vector<long>> trace;
+      long x = 0, y = 0;
+
+      for(long d = 0; d <= max_edits; d++) {
+        trace.push_back(v);
+
+        for(long k = -d; k <= d; k += 2) {
+          x = k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])? v[offset + k + 1]: v[offset + k - 1] + 1;
+          y = x - k;
+
+          while(x < n && y < m && a[x] == b[y]) {
+            x++;
+            y++;
+          }
+
+          v[offset + k] = x;
+
+          if(x >= n && y >= m) {
+            /* Walks back the trace from the end */
+            x = n;
+            y = m;
+
+            for(long e = d; e >= 0; e--) {
+              const std::vector<long>& w = trace[e];
+              long kk = x - y, pk = kk == -e || (kk != e && w[offset + kk - 1] < w[offset + kk + 1])? kk + 1: kk - 1, px = w[offset + pk], py = px - pk;
+
+              for(; x > px && y > py; x--, y--)
+                edits.push_back(DiffEdit{' ', size_t(x - 1), size_t(y - 1)});
+
+              if(e > 0) {
+                if(x == px)
+                  edits.push_back(DiffEdit{'+', size_t(x), size_t(y - 1)});
+                else
+                  edits.push_back(DiffEdit{'-', size_t(x - 1), size_t(y)});
+              }
+
+              x = px;
+              y = py;
+            }
+
+            std::reverse(edits.begin(), edits.end());
+
+            return true;
+          }
+        }
+      }
+
+      return false;
+    }
+
+    /*
+     * Renders a diff between two sequences for a failure message.
+     *
+     * The common prefix and suffix are skipped in linear time, and at most
+     * window elements of each sequence past the first mismatch are diffed,
+     * looking for at most max_edits edits, so that the cost stays linear in
+     * the length of the sequences. Changes are shown with two elements of
+     * context, as "-" lines for the elements of the first sequence and "+"
+     * lines for those of the second, each with its index into its own
+     * sequence; common elements show their index into the first. When the
+     * sequences differ by more edits, the differing positions are listed
+     * instead.
+     *
+     * a: The first sequence
+     * n: The length of the first sequence
+     * b: The second sequence
+     * m: The length of the second sequence
+     * first: The index of the first mismatch
+     * window: The maximum number of elements of each sequence to diff
+     * max_edits: The maximum number of edits to search for
+     *
+     * Return value: The diff
+     *
+     * I: A random access iterator type
+     * J: A random access iterator type
+     */
+    template<typename I, typename J> std::string diff(I a, size_t n, J b, size_t m, size_t first, size_t window = 4096, size_t max_edits = 64) {
+      const size_t context = 2, max_lines = 48;
+      std::vector<DiffEdit> edits;
+      std::ostringstream os;
+      size_t suffix = 0, len_a, len_b, lines = 0;
+      bool gap = false;
+
+      while(suffix < n - first && suffix < m - first && a[n - suffix - 1] == b[m - suffix - 1])
+        suffix++;
+
+      len_a = std::min(n - first - suffix, window);
+      len_b = std::min(m - first - suffix, window);
+
+      if(len_a < n - first - suffix || len_b < m - first - suffix)
+        os << "(diff limited to " << window << " elements from index " << first << ")\n";
+
+      if(!myers(a + first, long(len_a), b + first, long(len_b), long(max_edits), edits)) {
+        os << "(more than " << max_edits << " edits, listing the differing positions)\n";
+
+        for(size_t t = first; t < std::max(n, m); t++) {
+          if(t < n && t < m && a[t] == b[t])
+            continue;
+
+          if(lines == max_lines) {
+            os << "  ...\n";
+            break;
+          }
+
+          os << "  [" << t << "] " << (t < n? to_string(a[t]): std::string("(none)")) << " != " << (t < m? to_string(b[t]): std::string("(none)")) << "\n";
+          lines++;
+        }
+
+        return os.str();
+      }
+
+      /* Context before the first mismatch */
+      for(size_t t = first - std::min(first, context); t < first; t++)
+        os << "  [" << t << "] " << to_string(a[t]) << "\n";
+
+      for(size_t e = 0; e < edits.size(); e++) {
+        const DiffEdit& edit = edits[e];
+        size_t ia = first + edit.a, ib = first + edit.b;
+
+        if(edit.op == ' ') {
+          bool near = false;
+
+          for(size_t c = 1; c <= context && !near; c++)
+            near = (e >= c && edits[e - c].op != ' ') || (e + c < edits.size() && edits[e + c].op != ' ');
+
+          if(!near) {
+            gap = true;
+            continue;
+          }
+        }
+
+        if(gap)
+          os << "  ...\n";
+
+        gap = false;
+
+        if(lines++ == max_lines) {
+          os << "  ...\n";
+          break;
+        }
+
+        if(edit.op == '+')
+          os << "+ [" << ib << "] " << to_string(b[ib]) << "\n";
+        else
+          os << edit.op << " [" << ia << "] " << to_string(a[ia]) << "\n";
+      }
+
+      /* Context after the last change, from the common suffix */
+      if(lines <= max_lines && len_a == n - first - suffix && len_b == m - first - suffix)
+        for(size_t t = n - suffix; t < n - suffix + std::min(suffix, context); t++)
+          os << "  [" << t << "] " << to_string(a[t]) << "\n";
+
+      return os.str();
+    }
+  }
+
+  namespace detail {
+    /* Absence of a failure message */
+    struct NoMessage {};
+
+    /* Overload priority, higher ranks being preferred */
+    template<int N> struct Rank: Rank<N - 1> {};
+    template<> struct Rank<0> {};
+
+    inline std::string format_message(const NoMessage&, Rank<3>) { return std::string(); }
+    template<typename M> auto format_message(const M& message, Rank<2>) -> decltype(std::string(message)) { return std::string(message); }
+    template<typename M> auto format_message(const M& message, Rank<1>) -> decltype(std::string(message())) { return std::string(message()); }
+
+    template<typename M> auto format_message(const M& message, Rank<0>) -> decltype(message(std::declval<std::ostream&>()), std::string()) {
+      std::ostringstream os;
+
+      message(os);
+
+      return os.str();
+    }
+
+    /*
+     * Builds a failure message. Messages are given to the assertions
+     * unformatted and only built here, when the assertion fails.
+     *
+     * message: A string, a callable returning a string, or a callable
+     *          writing the message to the std::ostream it is given
+     *
+     * Return value: The message
+     *
+     * M: The message type
+     */
+    template<typename M> std::string format_message(const M& message) { return format_message(message, Rank<3>()); }
+  }
+
+  /*
+   * This class provides facilities for assertions.
+   *
+   * All the methods inside this class do not return any value and
+   * fail the test if the asserted condition is not met.
+   *
+   * Each assertion takes the location of its call as a last, defaulted
+   * argument, which is reported with the failure. Without compiler support
+   * (see ENKI_CALLER_LOCATION), the location is unknown unless passed
+   * explicitly, e.g. as SourceLocation(__FILE__, __LINE__). The comparison
+   * assertions also take an optional message (see detail::format_message()),
+   * built only on failure, so that it costs nothing in hot loops:
+   *
+   *   Assert::assert(v[t] >= 0, [&] { return "negative at " + std::to_string(t); });
+   */
+  class Assert {
+    public:
+      /*
+       * Asserts that a condition is true.
+       *
+       * condition: The condition
+       * location: The location of the assertion, the caller by default
+       */
+      static void assert(bool condition, const SourceLocation& location = SourceLocation::current()) {
+        if(!condition)
+          throw TestFailedException(Failure(std::string(), location));
+      }
+
+      /*
+       * Asserts that a condition is true.
+       *
+       * condition: The condition
+       * message: The failure message, see detail::format_message()
+       * location: The location of the assertion, the caller by default
+       *
+       * M: The message type
+       */
+      template<typename M> static void assert(bool condition, const M& message, const SourceLocation& location = SourceLocation::current()) {
+        if(!condition)
+          throw TestFailedException(Failure(detail::format_message(message), location));
+      }
+
+      /*
+       * Asserts that the time taken by a benchmark function does not grow with
+       * its input size faster than a complexity class.
+       *
+       * The function is measured for each input size, which it reads through
+       * Benchmark::range(), and the times are fitted to the complexity classes.
+       * The assertion fails if the best fit is a higher class than the given one.
+       *
+       * complexity: The highest complexity class allowed
+       * sizes: The input sizes, at least two
+       * func: The benchmark function, taking a Benchmark
+       * config: The benchmark configuration, each size is measured for config.min_time
+       * location: The location of the assertion, the caller by default
+       *
+       * F: The function type
+       */
+      template<typename F> static void assert_complexity(Complexity complexity, const std::vector<long long>& sizes, F func, const BenchmarkConfig& config = BenchmarkConfig(),
+          const SourceLocation& location = SourceLocation::current()) {
+        std::vector<std::pair<double, double>> samples;
+        ComplexityFit fit;
+
+        for(size_t t = 0; t < sizes.size(); t++) {
+          BenchmarkResult result = detail::measure(func, config, std::vector<long long>(1, sizes[t]));
+
+          samples.push_back(std::make_pair(double(result.complexity_n), result.time_per_iteration()));
+        }
+
+        fit = ComplexityFit::fit(samples);
+
+        if(fit.complexity > complexity) {
+          std::ostringstream os;
+
+          os << "Complexity " << ComplexityFit::name(fit.complexity) << " (RMS " << 100.0 * fit.rms << "%) exceeds " << ComplexityFit::name(complexity);
+
+          throw TestFailedException(Failure(os.str(), location));
+        }
+      }
+
+      /*
+       * Asserts that a candidate function is not slower than a reference one.
+       *
+       * Both functions are timed over the same number of samples, and the
+       * assertion only fails if the candidate is slower than the reference,
+       * times the tolerance, with the configured confidence; a difference that
+       * may be noise passes. The functions should have no lasting side effects,
+       * as they are called many times.
+       *
+       * candidate: The function expected to be faster
+       * reference: The function to compare against
+       * config: The comparison configuration
+       * location: The location of the assertion, the caller by default
+       *
+       * F: The candidate type, callable without arguments
+       * G: The reference type, callable without arguments
+       */
+      template<typename F, typename G> static void assert_faster_than(F candidate, G reference, const ComparisonConfig& config = ComparisonConfig(),
+          const SourceLocation& location = SourceLocation::current()) {
+        Comparison comparison = detail::compare(candidate, reference, config);
+
+        if(comparison.p < 1.0 - config.confidence) {
+          std::ostringstream os;
+
+          os << "Candidate median of " << comparison.candidate * 1e9 << "ns is " << comparison.ratio() << " times the reference median of "
+            << comparison.reference * 1e9 << "ns (tolerance " << config.tolerance << ", p = " << comparison.p << ")";
+
+          throw TestFailedException(Failure(os.str(), location));
+        }
+      }
+
+      /*
+       * Asserts that a function does not use more than a given amount of
+       * memory at its peak. The peak is measured by the allocation tracker if
+       * it is enabled (see ENKI_TRACK_ALLOCATIONS) and through the resident
+       * set size of the process if not.
+       *
+       * bytes: The maximum number of bytes
+       * func: The function to test
+       * location: The location of the assertion, the caller by default
+       */
+      static void assert_max_memory(long long bytes, std::function<void(void)> func, const SourceLocation& location = SourceLocation::current()) {
+        detail::MemoryProbe probe;
+        MemoryUsage usage;
+
+        func();
+        usage = probe.finish();
+
+        if(usage.peak() > bytes) {
+          std::ostringstream os;
+
+          os << "Memory peak of " << usage.peak() << " bytes " << (usage.tracked? "allocated": usage.approximate? "of RSS (approximate)": "of RSS") << " exceeds the limit of " << bytes << " bytes";
+
+          throw TestFailedException(Failure(os.str(), location));
+        }
+      }
+
+      /*
+       * Asserts that a percentile of a latency histogram is below a limit.
+       *
+       * histogram: The histogram
+       * p: The percentile, from 0 to 100, e.g. 99.9
+       * ns: The limit in nanoseconds
+       * location: The location of the assertion, the caller by default
+       */
+      static void assert_percentile_below(const LatencyHistogram& histogram, double p, std::uint64_t ns, const SourceLocation& location = SourceLocation::current()) {
+        std::uint64_t value = histogram.percentile(p);
+
+        if(value >= ns) {
+          std::ostringstream os;
+
+          os << "p" << p << " latency of " << value << "ns over " << histogram.get_count() << " samples is not below " << ns << "ns";
+
+          throw TestFailedException(Failure(os.str(), location));
+        }
+      }
+
+      /*
+       * Asserts that a percentile of the latency of an operation of the running
+       * test is below a limit (see TestCase::latency()).
+       *
+       * name: The operation name
+       * p: The percentile, from 0 to 100, e.g. 99.9
+       * ns: The limit in nanoseconds
+       * location: The location of the assertion, the caller by default
+       */
+      static void assert_percentile_below(const std::string& name, double p, std::uint64_t ns, const SourceLocation& location = SourceLocation::current()) {
+        const LatencyHistogram& histogram = detail::BenchmarkState<>::latency(name);
+        std::uint64_t value = histogram.percentile(p);
+
+        if(value >= ns) {
+          std::ostringstream os;
+
+          os << "p" << p << " latency of " << name << " of " << value << "ns over " << histogram.get_count() << " samples is not below " << ns << "ns";
+
+          throw TestFailedException(Failure(os.str(), location));
+        }
+      }
+
+      /*
+       * Asserts that no exception is thrown.
+       *
+       * func: The function to test
+       * location: The location of the assertion, the caller by default
+       */
+      static void assert_exception(typename std::function<void(void)> func, const SourceLocation& location = SourceLocation::current()) {
+        try {
+          func();
+        } catch(std::exception& e) {
+          throw TestFailedException(Failure(std::string("Unexpected exception: ") + e.what(), location));
+        } catch(...) {
+          throw TestFailedException(Failure("Unexpected exception", location));
+        }
+      }
+
+      /*
+       * Asserts that two arrays are equivalent. Two arrays are
+       * said to be equivalent when they have the same elements
+       * in the same order.
+       *
+       * On failure, the index of the first mismatch and a diff of the arrays
+       * (see detail::diff()) are attached to the failure, along with the
+       * location of the assertion. They are only built on failure.
+       *
+       * a: The first array
+       * b: The second array
+       * len_a: The length of a
+       * len_b: The length of b
+       * location: The location of the assertion, the caller by default
+       *
+       * T: The domain type of both arrays
+       */
+      template<typename T> static void assert_array_equals(const T* a, size_t len_a, const T* b, size_t len_b, const SourceLocation& location = SourceLocation::current()) {
+        assert_array_equals(a, len_a, b, len_b, detail::NoMessage(), location);
+      }
+
+      /*
+       * Asserts that two arrays are equivalent, see assert_array_equals().
+       *
+       * a: The first array
+       * b: The second array
+       * len_a: The length of a
+       * len_b: The length of b
+       * message: The failure message, see detail::format_message()
+       * location: The location of the assertion, the caller by default
+       *
+       * T: The domain type of both arrays
+       * M: The message type
+       */
+      template<typename T, typename M> static void assert_array_equals(const T* a, size_t len_a, const T* b, size_t len_b, const M& message,
+          const SourceLocation& location = SourceLocation::current()) {
+        if(len_a == len_b && std::equal(a, a + len_a, b))
+          return;
+
+        fail_sequences(a, len_a, b, len_b, "Arrays", message, location);
+      }
+
+      /*
+       * Asserts that two containers have the same elements in the same
+       * order, as assert_array_equals() does for arrays.
+       *
+       * a: The first container
+       * b: The second container
+       * location: The location of the assertion, the caller by default
+       *
+       * A: The first container type, with begin() and end()
+       * B: The second container type, with begin() and end()
+       */
+      template<typename A, typename B> static void assert_container_equals(const A& a, const B& b, const SourceLocation& location = SourceLocation::current()) {
+        assert_container_equals(a, b, detail::NoMessage(), location);
+      }
+
+      /*
+       * Asserts that two containers have the same elements in the same
+       * order, see assert_container_equals().
+       *
+       * a: The first container
+       * b: The second container
+       * message: The failure message, see detail::format_message()
+       * location: The location of the assertion, the caller by default
+       *
+       * A: The first container type, with begin() and end()
+       * B: The second container type, with begin() and end()
+       * M: The message type
+       */
+      template<typename A, typename B, typename M> static void assert_container_equals(const A& a, const B& b, const M& message, const SourceLocation& location = SourceLocation::current()) {
+        typedef typename std::decay<decltype(*std::begin(a))>::type VA;
+        typedef typename std::decay<decltype(*std::begin(b))>::type VB;
+        auto ia = std::begin(a);
+        auto ib = std::begin(b);
+
+        while(ia != std::end(a) && ib != std::end(b) && *ia == *ib) {
+          ia++;
+          ib++;
+        }
+
+        if(ia == std::end(a) && ib == std::end(b))
+          return;
+
+        /* The diff needs random access */
+        std::vector<VA> va(std::begin(a), std::end(a));
+        std::vector<VB> vb(std::begin(b), std::end(b));
+
+        fail_sequences(va.begin(), va.size(), vb.begin(), vb.size(), "Containers", message, location);
+      }
+
+      /*
+       * Asserts that a floating point value is near an expected one.
+       *
+       * actual: The value
+       * expected: The expected value
+       * tolerance: The tolerance, see Tolerance
+       * location: The location of the assertion, the caller by default
+       *
+       * F: float or double, the type of the value
+       */
+      template<typename F> static void assert_near(F actual, typename std::common_type<F>::type expected, const Tolerance& tolerance,
+          const SourceLocation& location = SourceLocation::current()) {
+        assert_near(actual, expected, tolerance, detail::NoMessage(), location);
+      }
+
+      /*
+       * Asserts that a floating point value is near an expected one.
+       *
+       * actual: The value
+       * expected: The expected value
+       * tolerance: The tolerance, see Tolerance
+       * message: The failure message, see detail::format_message()
+       * location: The location of the assertion, the caller by default
+       *
+       * F: float or double, the type of the value
+       * M: The message type
+       */
+      template<typename F, typename M> static void assert_near(F actual, typename std::common_type<F>::type expected, const Tolerance& tolerance, const M& message,
+          const SourceLocation& location = SourceLocation::current()) {
+        if(!detail::near(actual, expected, detail::LaneTolerance<F>(tolerance)))
+          throw TestFailedException(failure(message, describe_far(actual, expected), location));
+      }
+
+      /*
+       * Asserts that two floating point arrays have the same length and that
+       * their elements are near each other, one by one. The arrays are
+       * compared in blocks with SIMD code and only the blocks holding
+       * differences are looked at further, to report the worst one: the one
+       * with the largest absolute difference.
+       *
+       * a: The array
+       * len_a: The length of a
+       * b: The expected array
+       * len_b: The length of b
+       * tolerance: The tolerance, see Tolerance
+       * location: The location of the assertion, the caller by default
+       *
+       * F: float or double
+       */
+      template<typename F> static void assert_array_near(const F* a, size_t len_a, const F* b, size_t len_b, const Tolerance& tolerance,
+          const SourceLocation& location = SourceLocation::current()) {
+        assert_array_near(a, len_a, b, len_b, tolerance, detail::NoMessage(), location);
+      }
+
+      /*
+       * Asserts that the elements of two floating point arrays are near each
+       * other, see assert_array_near().
+       *
+       * a: The array
+       * len_a: The length of a
+       * b: The expected array
+       * len_b: The length of b
+       * tolerance: The tolerance, see Tolerance
+       * message: The failure message, see detail::format_message()
+       * location: The location of the assertion, the caller by default
+       *
+       * F: float or double
+       * M: The message type
+       */
+      template<typename F, typename M> static void assert_array_near(const F* a, size_t len_a, const F* b, size_t len_b, const Tolerance& tolerance, const M& message,
+          const SourceLocation& location = SourceLocation::current()) {
+        const size_t block = 4096;
+        detail::LaneTolerance<F> lane(tolerance);
+        size_t far = 0, worst = 0;
+        F worst_diff = -1;
+
+        if(len_a != len_b) {
+          std::ostringstream os;
+
+          os << "Array lengths differ: " << len_a << " and " << len_b;
+
+          throw TestFailedException(failure(message, os.str(), location));
+        }
+
+        for(size_t begin = 0; begin < len_a; begin += block) {
+          size_t end = std::min(begin + block, len_a), n = detail::count_far(a + begin, b + begin, end - begin, lane);
+
+          if(!n)
+            continue;
+
+          far += n;
+
+          for(size_t t = begin; t < end; t++) {
+            F diff = a[t] > b[t]? a[t] - b[t]: b[t] - a[t];
+
+            /* NaNs are the worst of all */
+            if(diff != diff)
+              diff = std::numeric_limits<F>::infinity();
+
+            if(diff > worst_diff && !detail::near(a[t], b[t], lane)) {
+              worst_diff = diff;
+              worst = t;
+            }
+          }
+        }
+
+        if(far) {
+          std::ostringstream os;
+
+          os << far << " of " << len_a << " elements are not near, the worst at index " << worst << ": " << describe_far(a[worst], b[worst]);
+
+          Failure details = failure(message, os.str(), location);
+
+          details.mismatch = static_cast<long long>(worst);
+
+          throw TestFailedException(details);
+        }
+      }
+
+      /*
+       * Asserts that a block of memory matches the content of a golden file.
+       *
+       * The golden file is memory mapped and compared as a whole. On a
+       * mismatch, the failure message gives the offset of the first difference
+       * and a hexdump of both contents around it. When the ENKI_UPDATE_GOLDEN
+       * environment variable is set to a value other than 0, a missing or
+       * different golden file is atomically replaced with the data instead,
+       * and the assertion passes.
+       *
+       * data: The data
+       * size: The data size in bytes
+       * path: The golden file path
+       * location: The location of the assertion, the caller by default
+       */
+      static void assert_matches_golden(const void* data, size_t size, const char* path, const SourceLocation& location = SourceLocation::current()) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        MappedFile golden;
+        size_t offset, begin;
+        bool missing = false; /* true if the golden file cannot be read */
+
+        try {
+          golden = MappedFile(path);
+        } catch(std::runtime_error&) {
+          if(!detail::update_golden())
+            throw TestFailedException(Failure(std::string("Golden file ") + path + " cannot be read (set ENKI_UPDATE_GOLDEN=1 to create it)", location));
+
+          missing = true;
+        }
+
+        offset = detail::mismatch(bytes, golden.data(), std::min(size, golden.size()));
+
+        if(!missing && offset == size && size == golden.size())
+          return;
+
+        if(detail::update_golden()) {
+          golden = MappedFile();
+
+          if(!detail::write_atomically(path, data, size))
+            throw TestFailedException(Failure(std::string("Golden file ") + path + " cannot be written", location));
+
+          return;
+        }
+
+        std::ostringstream os;
+
+        begin = (offset & ~size_t(15)) - std::min<size_t>(offset & ~size_t(15), 32);
+        os << "Output differs from golden file " << path << " at offset " << offset << " (0x" << std::hex << offset << std::dec << "; output " << size << " bytes, golden " << golden.size()
+          << " bytes; set ENKI_UPDATE_GOLDEN=1 to update it)\ngolden:\n" << detail::hexdump(golden.data(), golden.size(), begin, 80, offset)
+          << "output:\n" << detail::hexdump(bytes, size, begin, 80, offset);
+
+        Failure details(os.str(), location);
+
+        details.mismatch = static_cast<long long>(offset);
+
+        throw TestFailedException(details);
+      }
+
+      /*
+       * Asserts that a string matches the content of a golden file.
+       *
+       * See Assert::assert_matches_golden()
+       *
+       * data: The string
+       * path: The golden file path
+       * location: The location of the assertion, the caller by default
+       */
+      static void assert_matches_golden(const std::string& data, const char* path, const SourceLocation& location = SourceLocation::current()) {
+        assert_matches_golden(data.data(), data.size(), path, location);
+      }
+
+      /*
+       * Asserts that a string matches its snapshot, in the snapshot file of
+       * the running test case (see TestCase::set_snapshot_file()).
+       *
+       * The snapshot is keyed by the full name of the running test and by the
+       * given name or, if none, the index of the unnamed snapshot within the
+       * test run. Only the hashes are compared unless the snapshot differs. A
+       * missing snapshot is recorded, and the assertion passes. When the
+       * ENKI_UPDATE_SNAPSHOTS environment variable is set to a value other
+       * than 0, a different snapshot is replaced with the string instead.
+       *
+       * content: The string
+       * name: The snapshot name, or nullptr to number the snapshot
+       * location: The location of the assertion, the caller by default
+       */
+      static void assert_snapshot(const std::string& content, const char* name = nullptr, const SourceLocation& location = SourceLocation::current()) {
+        SnapshotStore* store = detail::SnapshotState<>::store;
+        std::string key = detail::SnapshotState<>::name + '#', stored;
+
+        if(!store)
+          throw TestFailedException(Failure("No snapshot file set for the test case", location));
+
+        key += name? std::string(name): detail::to_string(detail::SnapshotState<>::count++);
+
+        if(store->check(key, content, detail::update_snapshots(), stored) != SnapshotStore::Outcome::DIFFERS)
+          return;
+
+        size_t offset = std::mismatch(content.begin(), content.begin() + std::min(content.size(), stored.size()), stored.begin()).first - content.begin();
+        std::ostringstream os;
+
+        os << "Snapshot " << key << " differs at offset " << offset << " (snapshot " << stored.size() << " bytes, value " << content.size()
+          << " bytes; set ENKI_UPDATE_SNAPSHOTS=1 to update it)\nsnapshot: " << snapshot_line(stored, offset) << "\nvalue:    " << snapshot_line(content, offset);
+
+        Failure details(os.str(), location);
+
+        details.mismatch = static_cast<long long>(offset);
+
+        throw TestFailedException(details);
+      }
+
+      /*
+       * Asserts that a value matches its snapshot. The value is serialized
+       * as printed in failure messages.
+       *
+       * See Assert::assert_snapshot()
+       *
+       * value: The value
+       * name: The snapshot name, or nullptr to number the snapshot
+       * location: The location of the assertion, the caller by default
+       *
+       * V: The value type
+       */
+      template<typename V> static void assert_snapshot(const V& value, const char* name = nullptr, const SourceLocation& location = SourceLocation::current()) {
+        assert_snapshot(detail::to_string(value), name, location);
+      }
+
+      /*
+       * Asserts that a C string matches its snapshot.
+       *
+       * See Assert::assert_snapshot()
+       *
+       * content: The string
+       * name: The snapshot name, or nullptr to number the snapshot
+       * location: The location of the assertion, the caller by default
+       */
+      static void assert_snapshot(const char* content, const char* name = nullptr, const SourceLocation& location = SourceLocation::current()) {
+        assert_snapshot(std::string(content), name, location);
+      }
+
+      /*
+       * Asserts that all the elements in the given array are in the subdomain [min, max] from the domain T.
+       *
+       * arr: The array
+       * len_a: The length of the array
+       * min: The minimum value (inclusive)
+       * max: The maximum value (inclusive)
+       * location: The location of the assertion, the caller by default
+       *
+       * T: The domain type
+       */
+      template<typename T> static void assert_array_subdomain(const T* arr, size_t len_a, const T& min, const T& max, const SourceLocation& location = SourceLocation::current()) {
+        assert_array_subdomain(arr, len_a, min, max, detail::NoMessage(), location);
+      }
+
+      /*
+       * Asserts that all the elements in the given array are in the subdomain [min, max] from the domain T.
+       *
+       * arr: The array
+       * len_a: The length of the array
+       * min: The minimum value (inclusive)
+       * max: The maximum value (inclusive)
+       * message: The failure message, see detail::format_message()
+       * location: The location of the assertion, the caller by default
+       *
+       * T: The domain type
+       * M: The message type
+       */
+      template<typename T, typename M> static void assert_array_subdomain(const T* arr, size_t len_a, const T& min, const T& max, const M& message,
+          const SourceLocation& location = SourceLocation::current()) {
+        for(size_t t = 0; t < len_a; t++)
+          if(arr[t] < min || arr[t] > max) {
+            Failure details = failure(message, "Element " + detail::to_string(arr[t]) + " at index " + std::to_string(t) + " is not within ["
+              + detail::to_string(min) + ", " + detail::to_string(max) + "]", location);
+
+            details.mismatch = static_cast<long long>(t);
+
+            throw TestFailedException(details);
+          }
+      }
+
+      /*
+       * Asserts that a property holds for random values.
+       *
+       * The property is checked against config.cases values drawn from the
+       * generator, evaluated in parallel by config.workers threads. Each case is
+       * generated from its own seed derived from the run seed, so a run is
+       * reproduced by its seed whatever the number of workers. When the property
+       * fails, the failing value with the lowest case index is shrunk to a minimal
+       * counterexample, which is reported in the failure message along with the
+       * seed.
+       *
+       * gen: The value generator, see enki::gen
+       * property: The property, called with a value. It fails by returning false
+       *           or by throwing (e.g. through other assertions). It must be safe
+       *           to call from multiple threads unless config.workers is 1.
+       * config: The property configuration
+       * location: The location of the assertion, the caller by default
+       *
+       * G: The generator type
+       * F: The property type
+       */
+      template<typename G, typename F> static void assert_property(const G& gen, F property, const PropertyConfig& config = PropertyConfig(),
+          const SourceLocation& location = SourceLocation::current()) {
+        typedef typename G::value_type V;
+        std::uint64_t seed = config.seed? config.seed: detail::random_seed();
+        unsigned workers = config.workers? config.workers: detail::hardware_workers();
+        std::string failure; /* Failure message of the lowest failing case */
+        std::mutex failure_mutex;
+        std::atomic<size_t> first(config.cases); /* Lowest failing case */
+        auto generate = [&] (size_t index) {
+          std::mt19937_64 rng(detail::mix_seed(seed, index));
+
+          /* Sizes grow from 1 to max_size, or stay 0 when max_size is 0 */
+          return gen.generate(rng, config.cases > 1 && config.max_size? 1 + index * (config.max_size - 1) / (config.cases - 1): config.max_size);
+        };
+
+        detail::parallel_for(config.cases, workers, [&] (size_t index, unsigned) {
+          std::string msg;
+
+          if(index < first && !check_property(property, generate(index), msg)) {
+            std::lock_guard<std::mutex> lock(failure_mutex);
+
+            if(index < first) {
+              first = index;
+              failure = msg;
+            }
+          }
+        });
+
+        if(first == config.cases)
+          return;
+
+        V original = generate(first);
+        V value = original;
+        size_t steps = 0;
+
+        /* Greedy shrinking: move to the simplest candidate that still fails */
+        for(bool shrunk = true; shrunk && steps < config.max_shrinks; ) {
+          std::vector<V> candidates = gen.shrink(value);
+          std::vector<std::string> msgs(candidates.size());
+          std::atomic<size_t> found(candidates.size());
+
+          detail::parallel_for(candidates.size(), candidates.size() < 4 * workers? 1: workers, [&] (size_t index, unsigned) {
+            if(index < found && !check_property(property, candidates[index], msgs[index])) {
+              size_t cur = found;
+
+              while(index < cur && !found.compare_exchange_weak(cur, index));
+            }
+          });
+
+          shrunk = found < candidates.size();
+
+          if(shrunk) {
+            value = candidates[found];
+            failure = msgs[found];
+            steps++;
+          }
+        }
+
+        std::ostringstream os;
+
+        os << "Property falsified at case " << first << " of " << config.cases << " (seed " << seed << ")\n"
+          << "counterexample: " << detail::to_string(value) << "\n"
+          << "original: " << detail::to_string(original) << " (" << steps << " shrinks)";
+
+        if(!failure.empty())
+          os << "\nfailure: " << failure;
+
+        throw TestFailedException(Failure(os.str(), location));
+      }
+
+      /*
+       * Asserts that a property holds for random values drawn from the default
+       * generator of a type.
+       *
+       * See Assert::assert_property()
+       *
+       * property: The property
+       * config: The property configuration
+       * location: The location of the assertion, the caller by default
+       *
+       * V: The value type, see enki::gen::Arbitrary
+       * F: The property type
+       */
+      template<typename V, typename F> static void assert_property(F property, const PropertyConfig& config = PropertyConfig(), const SourceLocation& location = SourceLocation::current()) {
+        assert_property(gen::Arbitrary<V>(), property, config, location);
+      }
+
+    private:
+      /*
+       * Checks a property against a value.
+       *
+       * property: The property
+       * value: The value
+       * msg: Receives the failure message
+       *
+       * Return value: true if the property holds, false if not
+       */
+      template<typename F, typename V> static bool check_property(F& property, const V& value, std::string& msg) {
+        try {
+          if(call_property(property, value, std::is_convertible<decltype(property(value)), bool>()))
+            return true;
+
+          msg = "property returned false";
+        } catch(TestPassedException& e) {
+          return true;
+        } catch(TestFailedException& e) {
+          msg = e.message();
+        } catch(std::exception& e) {
+          msg = std::string("exception: ") + e.what();
+        } catch(...) {
+          msg = "unknown exception";
+        }
+
+        return false;
+      }
+
+      template<typename F, typename V> static bool call_property(F& property, const V& value, std::true_type) { return property(value); }
+      template<typename F, typename V> static bool call_property(F& property, const V& value, std::false_type) { property(value); return true; }
+
+      /*
+       * Fails the running test on two differing sequences, with the index of
+       * their first mismatch and their diff.
+       *
+       * a: The first sequence
+       * n: The length of the first sequence
+       * b: The second sequence
+       * m: The length of the second sequence
+       * what: The kind of the sequences, for the failure message
+       * message: The failure message given to the assertion
+       * location: The location of the assertion
+       *
+       * I: A random access iterator type
+       * J: A random access iterator type
+       * M: The message type
+       */
+      template<typename I, typename J, typename M> static void fail_sequences(I a, size_t n, J b, size_t m, const char* what, const M& message, const SourceLocation& location) {
+        std::ostringstream os;
+        size_t first = 0;
+
+        while(first < n && first < m && a[first] == b[first])
+          first++;
+
+        os << what << " differ at index " << first << " (" << n << " and " << m << " elements)";
+
+        Failure details = failure(message, os.str(), location);
+
+        details.mismatch = static_cast<long long>(first);
+        details.diff = detail::diff(a, n, b, m, first);
+
+        throw TestFailedException(details);
+      }
+
+      /*
+       * Builds the details of a failed assertion.
+       *
+       * message: The failure message given to the assertion
+       * description: The description of the failure by the assertion
+       * location: The location of the assertion
+       *
+       * Return value: The failure details, with the message preceding the description
+       *
+       * M: The message type
+       */
+      template<typename M> static Failure failure(const M& message, const std::string& description, const SourceLocation& location) {
+        std::string text = detail::format_message(message);
+
+        return Failure(text.empty()? description: description.empty()? text: text + ": " + description, location);
+      }
+
+      /*
+       * Describes how far apart two floating point values are.
+       *
+       * actual: The value
+       * expected: The expected value
+       *
+       * Return value: The description
+       */
+      template<typename F> static std::string describe_far(F actual, F expected) {
+        std::ostringstream os;
+        F diff = actual > expected? actual - expected: expected - actual, magnitude = std::max(std::fabs(actual), std::fabs(expected));
+
+        os.precision(std::numeric_limits<F>::max_digits10);
+        os << actual << " is not near " << expected << " (difference " << diff << ", relative " << (magnitude > 0? diff / magnitude: F(0))
+          << ", " << detail::ulp_distance(actual, expected) << " ULPs)";
+
+        return os.str();
+      }
+
+      /*
+       * Extracts the line of a snapshot containing an offset, escaping the
+       * control characters and shortening it around the offset.
+       *
+       * content: The snapshot content
+       * offset: The offset
+       *
+       * Return value: The line
+       */
+      static std::string snapshot_line(const std::string& content, size_t offset) {
+        size_t begin = offset > content.size()? content.size(): offset, end;
+        std::string line;
+
+        while(begin > 0 && content[begin - 1] != '\n' && offset - begin < 40)
+          begin--;
+
+        end = content.find('\n', begin);
+        end = std::min(end == std::string::npos? content.size(): end, begin + 80);
+
+        if(begin > 0 && content[begin - 1] != '\n')
+          line = "...";
+
+        for(size_t t = begin; t < end; t++) {
+          unsigned char c = static_cast<unsigned char>(content[t]);
+          char esc[8];
+
+          if(c >= 0x20 && c < 0x7f)
+            line += c;
+          else {
+            std::snprintf(esc, sizeof(esc), "\\x%02x", c);
+            line += esc;
+          }
+        }
+
+        if(end < content.size() && content[end] != '\n')
+          line += "...";
+
+        return line;
+      }
+  };
+
+  /*
+   * Generates a range of values, to be used as test parameters.
+   *
+   * begin: The first value (inclusive)
+   * end: The last value (exclusive)
+   * step: The difference between two consecutive values
+   *
+   * Return value: The values
+   *
+   * P: The value type
+   */
+  template<typename P> std::vector<P> range(P begin, P end, P step = P(1)) {
+    std::vector<P> values;
+
+    for(P v = begin; step > P(0)? v < end: v > end; v += step)
+      values.push_back(v);
+
+    return values;
+  }
+
+  /*
+   * Generates a geometric range of values, to be used as test or benchmark
+   * parameters.
+   *
+   * begin: The first value (inclusive), greater than 0
+   * end: The last value (exclusive)
+   * factor: The ratio between two consecutive values, greater than 1
+   *
+   * Return value: The values
+   *
+   * P: The value type
+   */
+  template<typename P> std::vector<P> geometric_range(P begin, P end, P factor = P(2)) {
+    std::vector<P> values;
+
+    for(P v = begin; v < end; v *= factor)
+      values.push_back(v);
+
+    return values;
+  }
+
+  /*
+   * Test selection filter.
+   *
+   * A filter is made of include and exclude rules. Name rules are either
+   * glob patterns (where '*' matches any sequence of characters and '?'
+   * matches a single character) or regular expressions, which are compiled
+   * once when added and matched against any part of the test name. Tag rules
+   * match the tags given to TestCase::add().
+   *
+   * Regular expressions are only available when ENKI_REGEX is defined before
+   * including this header, since <regex> is slow to compile; without it a
+   * regular expression rule throws std::invalid_argument.
+   *
+   * A test is selected when it matches at least one include name rule (if
+   * any), has at least one included tag (if any) and matches no exclude rule.
+   */
+  class TestFilter {
+    public:
+      /*
+       * Initializes an empty filter, selecting all the tests.
+       */
+      TestFilter() {}
+
+      /*
+       * Initializes a new filter from a specification string.
+       *
+       * See TestFilter::parse()
+       *
+       * spec: The filter specification
+       */
+      TestFilter(const char* spec) { parse(spec); }
+
+      /*
+       * Adds the rules from a specification string to this filter.
+       *
+       * The specification is a list of rules separated by ':'. The rules
+       * following the first '-' are exclude rules, the others are include rules.
+       * A rule starting with '@' is a tag, a rule enclosed in '/' is a regular
+       * expression, any other rule is a glob pattern.
+       *
+       * Example: "Parser*:@fast-*slow*:@network"
+       *
+       * spec: The filter specification
+       *
+       * Return value: This filter
+       */
+      TestFilter& parse(const char* spec) {
+        bool excl = false; /* Parsing exclude rules? */
+
+        while(spec && *spec) {
+          const char* end = spec;
+
+          while(*end && *end != ':' && !(*end == '-' && !excl))
+            end++;
+
+          std::string rule(spec, end);
+
+          if(!rule.empty()) {
+            if(rule[0] == '@')
+              add_tag(rule.c_str() + 1, excl);
+            else if(rule.size() > 1 && rule[0] == '/' && rule[rule.size() - 1] == '/')
+              add_regex(rule.substr(1, rule.size() - 2).c_str(), excl);
+            else
+              add_glob(rule.c_str(), excl);
+          }
+
+          if(*end == '-')
+            excl = true;
+
+          spec = *end? end + 1: end;
+        }
+
+        return *this;
+      }
+
+      /*
+       * Includes the tests whose name matches a glob pattern.
+       *
+       * pattern: The glob pattern
+       *
+       * Return value: This filter
+       */
+      TestFilter& include(const char* pattern) { return add_glob(pattern, false); }
+
+      /*
+       * Excludes the tests whose name matches a glob pattern.
+       *
+       * pattern: The glob pattern
+       *
+       * Return value: This filter
+       */
+      TestFilter& exclude(const char* pattern) { return add_glob(pattern, true); }
+
+      /*
+       * Includes the tests whose name matches a regular expression.
+       *
+       * re: The regular expression (ECMAScript syntax)
+       *
+       * Return value: This filter
+       */
+      TestFilter& include_regex(const char* re) { return add_regex(re, false); }
+
+      /*
+       * Excludes the tests whose name matches a regular expression.
+       *
+       * re: The regular expression (ECMAScript syntax)
+       *
+       * Return value: This filter
+       */
+      TestFilter& exclude_regex(const char* re) { return add_regex(re, true); }
+
+      /* Matcher of a name rule, true if the rule matches the name */
+      typedef std::function<bool(const char*)> Matcher;
+
+      /*
+       * Includes the tests having a tag.
+       *
+       * tag: The tag
+       *
+       * Return value: This filter
+       */
+      TestFilter& include_tag(const char* tag) { return add_tag(tag, false); }
+
+      /*
+       * Excludes the tests having a tag.
+       *
+       * tag: The tag
+       *
+       * Return value: This filter
+       */
+      TestFilter& exclude_tag(const char* tag) { return add_tag(tag, true); }
+
+      /*
+       * Checks whether this filter selects all the tests.
+       *
+       * Return value: true if the filter has no rules, false if not
+       */
+      bool empty() const {
+        return globs[0].empty() && globs[1].empty()
+          && regexes[0].empty() && regexes[1].empty()
+          && tags[0].empty() && tags[1].empty();
+      }
+
+      /*
+       * Matches a string against a glob pattern.
+       *
+       * pattern: The glob pattern
+       * str: The string
+       *
+       * Return value: true if the whole string matches the pattern, false if not
+       */
+      static bool glob_match(const char* pattern, const char* str) {
+        const char* star = nullptr; /* Position of the last '*' in the pattern */
+        const char* resume = nullptr; /* Position in str to resume from when backtracking */
+
+        while(*str) {
+          if(*pattern == '*') {
+            star = pattern++;
+            resume = str;
+          } else if(*pattern == '?' || *pattern == *str) {
+            pattern++;
+            str++;
+          } else if(star) {
+            pattern = star + 1;
+            str = ++resume;
+          } else
+            return false;
+        }
+
+        while(*pattern == '*')
+          pattern++;
+
+        return !*pattern;
+      }
+
+      /*
+       * Returns the length of the literal prefix of a glob pattern, that is the
+       * number of characters preceding the first wildcard.
+       *
+       * pattern: The glob pattern
+       *
+       * Return value: The literal prefix length
+       */
+      static size_t glob_prefix_length(const char* pattern) { return std::strcspn(pattern, "*?"); }
+
+      /* Rule lists, indexed by 0 for include rules and 1 for exclude rules */
+      std::vector<std::string> globs[2]; /* Glob patterns */
+      std::vector<Matcher> regexes[2]; /* Compiled regular expressions, type-erased */
+      std::vector<std::string> tags[2]; /* Tags */
+
+    private:
+      TestFilter& add_glob(const char* pattern, bool excl) { globs[excl].push_back(pattern); return *this; }
+      TestFilter& add_regex(const char* re, bool excl) {
+#ifdef ENKI_REGEX
+        std::shared_ptr<std::regex> compiled = std::make_shared<std::regex>(re, std::regex::ECMAScript | std::regex::optimize);
+
+        regexes[excl].push_back([compiled] (const char* name) { return std::regex_search(name, *compiled); });
+
+        return *this;
+#else
+        (void)excl;
+
+        throw std::invalid_argument(std::string("regular expression rule needs ENKI_REGEX: ") + re);
+#endif /* ENKI_REGEX */
+      }
+
+      TestFilter& add_tag(const char* tag, bool excl) { tags[excl].push_back(tag); return *this; }
+  };
+
+  /*
+   * Process-wide registry of shared resources.
+   *
+   * A shared resource is identified by a key and is constructed the first time
+   * it is requested, by any fixture of any test case type. Concurrent requests
+   * for the same resource wait for a single construction, while resources with
+   * different keys are constructed independently. Resources live until the
+   * process ends.
+   */
+  class SharedResources {
+    public:
+      /*
+       * Gets a shared resource, constructing it through a factory if it does not exist.
+       *
+       * key: The resource key
+       * factory: A callable returning a pointer to a new resource, which is owned by the registry.
+       *          If it throws, the resource is not created and the exception is propagated.
+       *
+       * Return value: The resource
+       *
+       * R: The resource type. Requesting an existing resource with a different type throws std::logic_error.
+       */
+      template<typename R, typename F> static R& get(const std::string& key, F factory) {
+        Entry& entry = find(key);
+
+        std::call_once(entry.once, [&] {
+          entry.resource = std::shared_ptr<void>(static_cast<R*>(factory()), [] (void* r) { delete static_cast<R*>(r); });
+          entry.type = &typeid(R);
+        });
+
+        if(*entry.type.load() != typeid(R))
+          throw std::logic_error("enki: shared resource " + key + " requested with a different type");
+
+        return *static_cast<R*>(entry.resource.get());
+      }
+
+      /*
+       * Gets a shared resource, default constructing it if it does not exist.
+       *
+       * key: The resource key
+       *
+       * Return value: The resource
+       *
+       * R: The resource type
+       */
+      template<typename R> static R& get(const std::string& key) { return get<R>(key, [] { return new R(); }); }
+
+      /*
+       * Gets a shared read-only file, mapping it into memory if it is not mapped yet.
+       *
+       * path: The file path
+       *
+       * Return value: The mapped file
+       */
+      static const MappedFile& file(const std::string& path) { return get<MappedFile>("enki:file:" + path, [&path] { return new MappedFile(path.c_str()); }); }
+
+      /*
+       * Checks whether a shared resource has been constructed.
+       *
+       * key: The resource key
+       *
+       * Return value: true if the resource exists, false if not
+       */
+      static bool contains(const std::string& key) {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        std::map<std::string, std::unique_ptr<Entry>>::const_iterator it = reg.entries.find(key);
+
+        return it != reg.entries.end() && it->second->type.load();
+      }
+
+    private:
+      /* Registry entry */
+      struct Entry {
+        std::once_flag once; /* Construction flag */
+        std::shared_ptr<void> resource; /* The resource */
+        std::atomic<const std::type_info*> type{nullptr}; /* The resource type, nullptr until constructed */
+      };
+
+      /* Resource registry */
+      struct Registry {
+        std::mutex mutex; /* Registry lock, not held while constructing resources */
+        std::map<std::string, std::unique_ptr<Entry>> entries; /* Entries, by key */
+      };
+
+      static Registry& registry() {
+        static Registry reg;
+
+        return reg;
+      }
+
+      static Entry& find(const std::string& key) {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        std::unique_ptr<Entry>& entry = reg.entries[key];
+
+        if(!entry)
+          entry.reset(new Entry());
+
+        return *entry;
+      }
+  };
+
+  /*
+   * Fuzz test configuration.
+   */
+  struct FuzzConfig {
+    const char* corpus_dir = nullptr; /* Corpus directory, loaded at start and extended with the new interesting inputs */
+    const char* artifact_dir = nullptr; /* Directory receiving the failing and crashing inputs, nullptr not to save them */
+    size_t runs = 100000; /* Maximum number of executions, 0 for no limit */
+    double max_time = 0.0; /* Maximum fuzzing time in seconds, 0 for no limit */
+    size_t max_len = 4096; /* Maximum input length */
+    unsigned workers = 0; /* Number of fuzzing threads, 0 for one per hardware thread */
+    std::uint64_t seed = 0; /* Random seed, 0 for a new seed on each run */
+  };
+
+  /*
+   * Fuzzing result.
+   */
+  struct FuzzResult {
+    bool failed = false; /* true if an input made the target fail */
+    std::vector<std::uint8_t> input; /* The failing input, minimized */
+    size_t original_size = 0; /* The size of the failing input before minimization */
+    std::string message; /* The failure message of the target */
+    std::string artifact; /* The path the failing input was saved to, empty if not saved */
+    size_t executions = 0; /* Number of target executions */
+    size_t corpus_size = 0; /* Number of corpus entries */
+    size_t features = 0; /* Number of coverage features discovered */
+    std::uint64_t seed = 0; /* Random seed */
+
+    /*
+     * Describes the failure in a human readable form.
+     *
+     * Return value: The failure report
+     */
+    std::string report() const {
+      std::ostringstream os;
+
+      os << "Fuzz target failed after " << executions << " executions (seed " << seed << ", corpus " << corpus_size << ", features " << features << ")\n"
+        << "input: " << input.size() << " bytes, minimized from " << original_size << "\n"
+        << detail::hexdump(input.data(), input.size());
+
+      if(!artifact.empty())
+        os << "saved to: " << artifact << "\n";
+
+      if(!message.empty())
+        os << "failure: " << message;
+
+      return os.str();
+    }
+  };
+
+  namespace detail {
+    /*
+     * State of the fuzzing crash handler, saving the input of a worker whose
+     * target crashes the process.
+     */
+    template<typename D = void> struct CrashState {
+      static char dir[1024]; /* Artifact directory, empty when crashes are not saved */
+      static thread_local const std::uint8_t* data; /* Input being run by this thread */
+      static thread_local size_t size; /* Size of the input being run by this thread */
+#ifdef ENKI_POSIX
+      static const int signals[5]; /* The signals handled */
+      static struct sigaction previous[5]; /* The actions installed before the handler, per signal */
+#endif /* ENKI_POSIX */
+    };
+
+    template<typename D> char CrashState<D>::dir[1024] = "";
+    template<typename D> thread_local const std::uint8_t* CrashState<D>::data = nullptr;
+    template<typename D> thread_local size_t CrashState<D>::size = 0;
+#ifdef ENKI_POSIX
+    template<typename D> const int CrashState<D>::signals[5] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+    template<typename D> struct sigaction CrashState<D>::previous[5];
+
+    /*
+     * Signal handler saving the input of the crashing thread as an artifact,
+     * or writing it in hex to the standard error when there is no artifact
+     * directory, then restoring the previous action and raising the signal
+     * again. Only async-signal-safe functions are used.
+     *
+     * sig: The signal
+     */
+    inline void crash_handler(int sig) {
+      static const char digits[] = "0123456789abcdef";
+      const std::uint8_t* data = CrashState<>::data;
+      size_t size = CrashState<>::size;
+      ssize_t r;
+
+      if(data && CrashState<>::dir[0]) {
+        char path[1100];
+        size_t len = std::strlen(CrashState<>::dir);
+        std::uint64_t h = hash64(data, size);
+        int fd;
+
+        std::memcpy(path, CrashState<>::dir, len);
+        std::memcpy(path + len, "/crash-", 7);
+        len += 7;
+
+        for(int t = 60; t >= 0; t -= 4)
+          path[len++] = digits[(h >> t) & 15];
+
+        path[len] = 0;
+        fd = ::open(path, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+
+        if(fd >= 0) {
+          r = ::write(fd, data, size);
+          ::close(fd);
+          r = ::write(2, "enki: fuzz target crashed, input saved to ", 42);
+          r = ::write(2, path, len);
+          r = ::write(2, "\n", 1);
+        } else
+          data = nullptr;
+      } else if(data) {
+        char hex[128];
+
+        r = ::write(2, "enki: fuzz target crashed on input ", 35);
+
+        for(size_t t = 0; t < size; t += sizeof(hex) / 2) {
+          size_t n = std::min(size - t, sizeof(hex) / 2);
+
+          for(size_t i = 0; i < n; i++) {
+            hex[2 * i] = digits[data[t + i] >> 4];
+            hex[2 * i + 1] = digits[data[t + i] & 15];
+          }
+
+          r = ::write(2, hex, 2 * n);
+        }
+
+        r = ::write(2, "\n", 1);
+      }
+
+      (void)r;
+
+      for(size_t t = 0; t < sizeof(CrashState<>::signals) / sizeof(CrashState<>::signals[0]); t++)
+        if(CrashState<>::signals[t] == sig)
+          ::sigaction(sig, &CrashState<>::previous[t], nullptr);
+
+      ::raise(sig);
+    }
+#endif /* ENKI_POSIX */
+  }
+
+  /*
+   * Coverage guided fuzzer.
+   *
+   * The fuzzer runs a target on inputs mutated from a corpus. When the code is
+   * built with -fsanitize-coverage=trace-pc-guard (or trace-pc with GCC) and
+   * ENKI_FUZZ_COVERAGE is defined, the inputs reaching new code or new hit
+   * counts are added to the corpus, shared by all the workers, and saved to the
+   * corpus directory. Without coverage feedback the corpus is only mutated.
+   *
+   * Corpus files are memory mapped. An input failing the target (by throwing)
+   * stops the fuzzing, is minimized and saved to the artifact directory with a
+   * "failure-" prefix; an input crashing the process is saved with a "crash-"
+   * prefix (or written to the standard error without an artifact directory) by
+   * a signal handler, which then hands the signal to the previous handler.
+   */
+  class Fuzzer {
+    public:
+      /*
+       * Fuzz target type. The target is called with the worker index and the
+       * input, and fails by throwing.
+       */
+      typedef std::function<void(unsigned, const std::uint8_t*, size_t)> Target;
+
+      /*
+       * Initializes a new fuzzer.
+       *
+       * config: The fuzzing configuration
+       */
+      Fuzzer(const FuzzConfig& config): config(config), nworkers(config.workers? config.workers: detail::hardware_workers()),
+        seed(config.seed? config.seed: detail::random_seed()), features(0) {}
+
+      /*
+       * Returns the number of workers.
+       *
+       * Return value: The number of workers
+       */
+      unsigned workers() const { return nworkers; }
+
+      /*
+       * Runs the target on each corpus entry and on an empty input.
+       *
+       * target: The fuzz target
+       *
+       * Return value: The result, reporting the first failing input
+       */
+      FuzzResult replay(Target target) {
+        FuzzResult result;
+        std::vector<std::uint8_t> empty;
+
+        load_corpus();
+        result.seed = seed;
+
+        for(size_t t = 0; t <= entries.size() && !result.failed; t++) {
+          const std::uint8_t* data = t < entries.size()? entries[t].first: empty.data();
+          size_t size = t < entries.size()? entries[t].second: 0;
+
+          result.executions++;
+
+          if(!execute(target, 0, data, size, result.message)) {
+            result.failed = true;
+            result.input.assign(data, data + size);
+            result.original_size = size;
+
+            if(t < files.size())
+              result.artifact = files[t];
+          }
+        }
+
+        result.corpus_size = entries.size();
+
+        return result;
+      }
+
+      /*
+       * Fuzzes the target until the configured number of executions or time is
+       * reached, or an input fails.
+       *
+       * target: The fuzz target
+       *
+       * Return value: The fuzzing result
+       */
+      FuzzResult fuzz(Target target) {
+        FuzzResult result;
+        std::atomic<size_t> executions(0);
+        std::atomic<bool> stop(false);
+        std::mutex result_mutex;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::uint32_t map_size = 1 << 16;
+
+        load_corpus();
+
+        if(entries.empty())
+          add_entry(std::vector<std::uint8_t>(), false);
+
+        while(map_size <= detail::CoverageState<>::guards)
+          map_size <<= 1;
+
+        seen.reset(new std::atomic<std::uint8_t>[map_size]);
+
+        for(std::uint32_t t = 0; t < map_size; t++)
+          seen[t] = 0;
+
+        features = 0;
+        install_crash_handler(true);
+
+        detail::parallel_for(nworkers, nworkers, [&] (size_t w, unsigned) {
+          std::mt19937_64 rng(detail::mix_seed(seed, w));
+          std::vector<std::uint8_t> map(map_size);
+          std::vector<std::uint32_t> touched(map_size);
+          std::vector<std::uint8_t> input;
+          std::string msg;
+
+          while(!stop) {
+            size_t n = executions++;
+
+            if((config.runs && n >= config.runs) || (config.max_time > 0.0
+                && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= config.max_time))
+              break;
+
+            pick(rng, input);
+            mutate(rng, input);
+
+            detail::CoverageState<>::map_size = map_size;
+            detail::CoverageState<>::touched = touched.data();
+            detail::CoverageState<>::touched_count = 0;
+            detail::CoverageState<>::map = map.data();
+
+            bool passed = execute(target, static_cast<unsigned>(w), input.data(), input.size(), msg);
+
+            detail::CoverageState<>::map = nullptr;
+
+            if(!passed) {
+              std::lock_guard<std::mutex> lock(result_mutex);
+
+              if(!result.failed) {
+                result.failed = true;
+                result.input = input;
+                result.message = msg;
+              }
+
+              stop = true;
+            } else if(collect_features(map, touched.data(), detail::CoverageState<>::touched_count))
+              add_entry(input, true);
+          }
+        });
+
+        install_crash_handler(false);
+
+        result.executions = std::min<size_t>(executions, config.runs? config.runs: executions.load());
+        result.corpus_size = entries.size();
+        result.features = features;
+        result.seed = seed;
+
+        if(result.failed) {
+          result.original_size = result.input.size();
+          minimize(target, result);
+          result.artifact = save(config.artifact_dir, "failure-", result.input);
+        }
+
+        return result;
+      }
+
+    private:
+      /*
+       * Runs the target on an input.
+       *
+       * target: The fuzz target
+       * worker: The worker index
+       * data: The input
+       * size: The input size
+       * msg: Receives the failure message
+       *
+       * Return value: true if the target passed, false if it failed
+       */
+      static bool execute(Target& target, unsigned worker, const std::uint8_t* data, size_t size, std::string& msg) {
+        bool passed = false;
+
+        detail::CrashState<>::data = data;
+        detail::CrashState<>::size = size;
+
+        try {
+          target(worker, data, size);
+          passed = true;
+        } catch(TestPassedException& e) {
+          passed = true;
+        } catch(TestFailedException& e) {
+          msg = e.message();
+        } catch(std::exception& e) {
+          msg = std::string("exception: ") + e.what();
+        } catch(...) {
+          msg = "unknown exception";
+        }
+
+        detail::CrashState<>::data = nullptr;
+
+        return passed;
+      }
+
+      /*
+       * Loads the corpus directory, mapping its files into memory.
+       */
+      void load_corpus() {
+        if(!entries.empty() || !config.corpus_dir)
+          return;
+
+        std::vector<std::string> paths = detail::list_files(config.corpus_dir);
+
+        for(std::vector<std::string>::iterator it = paths.begin(); it != paths.end(); it++) {
+          try {
+            MappedFile file(it->c_str());
+
+            if(file.size() <= config.max_len) {
+              entries.push_back(std::make_pair(file.data(), file.size()));
+              files.push_back(*it);
+              mapped.push_back(std::move(file));
+            }
+          } catch(std::runtime_error& e) {
+            /* Skip unreadable files */
+          }
+        }
+      }
+
+      /*
+       * Adds an input to the corpus.
+       *
+       * input: The input
+       * persist: true to also save the input to the corpus directory
+       */
+      void add_entry(const std::vector<std::uint8_t>& input, bool persist) {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+
+          owned.push_back(input);
+          entries.push_back(std::make_pair(owned.back().data(), owned.back().size()));
+        }
+
+        if(persist)
+          save(config.corpus_dir, "", input);
+      }
+
+      /*
+       * Copies a random corpus entry.
+       *
+       * rng: The random generator
+       * input: Receives the entry
+       */
+      void pick(std::mt19937_64& rng, std::vector<std::uint8_t>& input) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const std::pair<const std::uint8_t*, size_t>& entry = entries[rng() % entries.size()];
+
+        input.assign(entry.first, entry.first + entry.second);
+      }
+
+      /*
+       * Applies a random stack of mutations to an input.
+       *
+       * rng: The random generator
+       * input: The input
+       */
+      ENKI_NO_COVERAGE void mutate(std::mt19937_64& rng, std::vector<std::uint8_t>& input) {
+        static const std::uint8_t interesting[] = { 0, 1, 0x7f, 0x80, 0xff, 0x20, 0x40, 0x64, 0xfe };
+        size_t count = 1 + rng() % 4;
+
+        for(size_t m = 0; m < count; m++) {
+          size_t size = input.size();
+          size_t pos = size? rng() % size: 0;
+
+          switch(size? rng() % 8: 2) {
+            case 0: /* Flip a bit */
+              input[pos] ^= std::uint8_t(1u << (rng() % 8));
+              break;
+            case 1: /* Set a random byte */
+              input[pos] = std::uint8_t(rng());
+              break;
+            case 2: /* Insert random bytes */
+              if(size < config.max_len)
+                input.insert(input.begin() + (size? rng() % (size + 1): 0), 1 + rng() % std::min<size_t>(8, config.max_len - size), std::uint8_t(rng()));
+              break;
+            case 3: /* Erase bytes */
+              input.erase(input.begin() + pos, input.begin() + pos + 1 + rng() % std::min<size_t>(8, size - pos));
+              break;
+            case 4: /* Set an interesting value */
+              input[pos] = interesting[rng() % sizeof(interesting)];
+              break;
+            case 5: /* Add a small value */
+              input[pos] = std::uint8_t(input[pos] + 1 + rng() % 16 - 8);
+              break;
+            case 6: { /* Copy a chunk over another position */
+              size_t len = 1 + rng() % std::min<size_t>(16, size);
+              size_t from = rng() % (size - len + 1);
+              size_t to = rng() % (size - len + 1);
+
+              std::memmove(&input[to], &input[from], len);
+              break;
+            }
+            default: { /* Splice with another corpus entry */
+              std::vector<std::uint8_t> other;
+
+              pick(rng, other);
+
+              if(!other.empty()) {
+                size_t from = rng() % other.size();
+                size_t len = std::min(1 + rng() % (other.size() - from), config.max_len - std::min(config.max_len, pos));
+
+                input.resize(pos);
+                input.insert(input.end(), other.begin() + from, other.begin() + from + len);
+              }
+            }
+          }
+        }
+
+        if(input.size() > config.max_len)
+          input.resize(config.max_len);
+      }
+
+      /*
+       * Collects the coverage features of an execution and clears the counters.
+       *
+       * A feature is a hit counter falling in a new bucket (1, 2, 3, 4-7, 8-15,
+       * 16-31, 32-127, 128+ hits). Only the counters the execution touched are
+       * looked at, rather than the whole map.
+       *
+       * map: The hit counters
+       * touched: The indices of the counters the execution touched
+       * count: The number of touched indices
+       *
+       * Return value: true if the execution discovered new features
+       */
+      ENKI_NO_COVERAGE bool collect_features(std::vector<std::uint8_t>& map, const std::uint32_t* touched, std::uint32_t count) {
+        bool found = false;
+
+        for(std::uint32_t i = 0; i < count; i++) {
+          std::uint32_t t = touched[i];
+          std::uint8_t hits = map[t];
+          std::uint8_t bucket = hits < 4? std::uint8_t(1u << (hits - 1)): hits < 8? 8: hits < 16? 16: hits < 32? 32: hits < 128? 64: 128;
+
+          if(!(seen[t].load(std::memory_order_relaxed) & bucket) && !(seen[t].fetch_or(bucket) & bucket)) {
+            features++;
+            found = true;
+          }
+
+          map[t] = 0;
+        }
+
+        return found;
+      }
+
+      /*
+       * Minimizes a failing input by removing chunks of decreasing size while
+       * the target keeps failing.
+       *
+       * target: The fuzz target
+       * result: The fuzzing result, holding the failing input
+       */
+      void minimize(Target& target, FuzzResult& result) {
+        std::vector<std::uint8_t>& input = result.input;
+        size_t attempts = 0;
+        std::string msg;
+
+        for(size_t chunk = std::max<size_t>(input.size() / 2, 1); chunk > 0 && !input.empty(); chunk /= 2)
+          for(size_t pos = 0; pos < input.size() && attempts < 10000; attempts++) {
+            std::vector<std::uint8_t> candidate(input.begin(), input.begin() + pos);
+
+            candidate.insert(candidate.end(), input.begin() + std::min(pos + chunk, input.size()), input.end());
+
+            if(!execute(target, 0, candidate.data(), candidate.size(), msg)) {
+              input.swap(candidate);
+              result.message = msg;
+            } else
+              pos += chunk;
+          }
+      }
+
+      /*
+       * Saves an input to a directory, naming it after its hash.
+       *
+       * dir: The directory, or nullptr not to save the input
+       * prefix: The file name prefix
+       * input: The input
+       *
+       * Return value: The file path, or an empty string if the input was not saved
+       */
+      static std::string save(const char* dir, const char* prefix, const std::vector<std::uint8_t>& input) {
+        if(!dir)
+          return std::string();
+
+        char name[24];
+
+        std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(detail::hash64(input.data(), input.size())));
+
+        std::string path = std::string(dir) + "/" + prefix + name;
+        std::ofstream os(path.c_str(), std::ios::binary);
+
+        os.write(reinterpret_cast<const char*>(input.data()), input.size());
+
+        return os? path: std::string();
+      }
+
+      /*
+       * Installs or removes the crash handler. The handler is installed even
+       * without an artifact directory, to report the crashing input.
+       *
+       * install: true to install the handler, false to restore the previous handlers
+       */
+      void install_crash_handler(bool install) {
+#ifdef ENKI_POSIX
+        typedef detail::CrashState<> State;
+
+        std::strncpy(State::dir, install && config.artifact_dir? config.artifact_dir: "", sizeof(State::dir) - 1);
+
+        for(size_t t = 0; t < sizeof(State::signals) / sizeof(State::signals[0]); t++) {
+          if(install) {
+            struct sigaction action;
+
+            std::memset(&action, 0, sizeof(action));
+            action.sa_handler = detail::crash_handler;
+            sigemptyset(&action.sa_mask);
+            ::sigaction(State::signals[t], &action, &State::previous[t]);
+          } else
+            ::sigaction(State::signals[t], &State::previous[t], nullptr);
+        }
+#else
+        (void)install;
+#endif /* ENKI_POSIX */
+      }
+
+      FuzzConfig config; /* Fuzzing configuration */
+      unsigned nworkers; /* Number of workers */
+      std::uint64_t seed; /* Random seed */
+      std::mutex mutex; /* Corpus lock */
+      std::vector<MappedFile> mapped; /* Corpus entries loaded from the corpus directory */
+      std::vector<std::string> files; /* Paths of the mapped corpus entries */
+      std::deque<std::vector<std::uint8_t>> owned; /* Corpus entries found while fuzzing */
+      std::vector<std::pair<const std::uint8_t*, size_t>> entries; /* All the corpus entries */
+      std::unique_ptr<std::atomic<std::uint8_t>[]> seen; /* Feature buckets seen so far, by counter */
+      std::atomic<size_t> features; /* Number of features seen so far */
+  };
+
+  /*
+   * Fixture isolation modes.
+   */
+  enum class Isolation {
+    SHARED, /* All the tests run on the test case object, setup() and cleanup() are called once */
+    PER_TEST /* Each test runs on a pooled fixture, setup() and cleanup() are called around each test */
+  };
+
+  namespace detail {
+    /*
+     * State of the fixture construction.
+     *
+     * T: The fixture type
+     */
+    template<typename T> struct FixtureState {
+      static thread_local bool constructing; /* true while this thread constructs a pooled fixture of type T */
+    };
+
+    template<typename T> thread_local bool FixtureState<T>::constructing = false;
+  }
+
+  /*
+   * Pool of fixture objects.
+   *
+   * Fixtures are constructed once and reused: a fixture returned to the pool is
+   * handed out again as it is, so its expensive members (large buffers,
+   * preloaded data) should be built by the constructor while setup() and
+   * cleanup() only reset the state used by a single test.
+   *
+   * The tests are only registered by the test case running them: the calls to
+   * TestCase::add() and its variants made by the constructor of a pooled
+   * fixture are ignored, so a fixture only costs its own members rather than
+   * a copy of the whole test list.
+   *
+   * This class is thread safe.
+   *
+   * T: The fixture type
+   */
+  template<typename T> class FixturePool {
+    public:
+      typedef std::function<T*()> Factory; /* Fixture factory type */
+
+      /*
+       * Initializes a new pool constructing its fixtures through the default
+       * constructor of T.
+       */
+      FixturePool(): factory(nullptr) {}
+
+      FixturePool(const FixturePool&) = delete;
+      FixturePool& operator=(const FixturePool&) = delete;
+
+      /*
+       * Sets the factory used to construct new fixtures.
+       *
+       * factory: The fixture factory, or nullptr to use the default constructor of T
+       */
+      void set_factory(Factory factory) { this->factory = factory; }
+
+      /*
+       * Constructs fixtures until the pool holds at least the given number of
+       * idle fixtures.
+       *
+       * count: The number of fixtures
+       */
+      void reserve(size_t count) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        while(idle.size() < count)
+          idle.push_back(std::unique_ptr<T>(construct()));
+      }
+
+      /*
+       * Takes a fixture from the pool, constructing a new one if none is idle.
+       *
+       * Return value: The fixture
+       */
+      std::unique_ptr<T> acquire() {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+
+          if(!idle.empty()) {
+            std::unique_ptr<T> fixture(std::move(idle.back()));
+
+            idle.pop_back();
+
+            return fixture;
+          }
+        }
+
+        return std::unique_ptr<T>(construct());
+      }
+
+      /*
+       * Constructs a new fixture, bypassing the idle ones. The fixture can be
+       * returned to the pool once it is no longer needed.
+       *
+       * Return value: The fixture
+       */
+      std::unique_ptr<T> create() const { return std::unique_ptr<T>(construct()); }
+
+      /*
+       * Returns a fixture to the pool.
+       *
+       * fixture: The fixture
+       */
+      void release(std::unique_ptr<T> fixture) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        idle.push_back(std::move(fixture));
+      }
+
+      /*
+       * Destroys all the idle fixtures.
+       */
+      void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        idle.clear();
+      }
+
+      /*
+       * Returns the number of idle fixtures.
+       *
+       * Return value: The number of idle fixtures
+       */
+      size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        return idle.size();
+      }
+
+    private:
+      T* construct() const {
+        struct Guard {
+          Guard() { detail::FixtureState<T>::constructing = true; }
+          ~Guard() { detail::FixtureState<T>::constructing = false; }
+        } guard;
+
+        return factory? factory(): construct(std::is_default_constructible<T>());
+      }
+
+      static T* construct(std::true_type) { return new T(); }
+      static T* construct(std::false_type) { throw std::logic_error("enki: fixture is not default constructible and no factory is set"); }
+
+      Factory factory; /* Fixture factory */
+      std::vector<std::unique_ptr<T>> idle; /* Idle fixtures */
+      mutable std::mutex mutex; /* Pool lock */
+  };
+
+  /*
+   * Test case class. Subclasses of this class hold the test code and data.
+   *
+   * This class itself is responsible for running the setup/cleanup functions,
+   * test running and success/failure identification, test data storage.
+   *
+   * T: The type of the child class
+   */
+  template<typename T> class TestCase {
+    public:
+      typedef void (T::*TestFunc)(); /* Test function type */
+
+      /*
+       * Group of generated tests sharing the same test code, such as the
+       * instances of a parameterized test. The group holds the per-instance data
+       * so that each generated test only stores its index into the group.
+       */
+      class TestGroup {
+        public:
+          virtual ~TestGroup() {}
+
+          /*
+           * Runs a test of the group.
+           *
+           * fixture: The fixture to run the test on
+           * index: The test index into the group
+           */
+          virtual void invoke(T& fixture, size_t index) = 0;
+
+          /*
+           * Generates the name of a test of the group.
+           *
+           * base: The group name
+           * index: The test index into the group
+           *
+           * Return value: The test name
+           */
+          virtual std::string name(const char* base, size_t index) const { return std::string(base) + "/" + std::to_string(index); }
+
+          /*
+           * Checks whether the tests of the group flush the caches (see flush_cache()).
+           *
+           * Return value: true if they do
+           */
+          virtual bool flushes_cache() const { return false; }
+      };
+
+    private:
+      template<typename P> class ParamGroup;
+      class TypedGroup;
+      class FuzzGroup;
+      class BenchmarkGroup;
+
+    public:
+
+      /*
+       * Measurements and failure details of a test, kept apart from its data
+       * and only allocated once a run fills them, so that the tests not run
+       * (such as the generated instances left out by the filter) stay small.
+       */
+      struct TestDetails {
+        BenchmarkResult benchmark; /* Benchmark result of the last run */
+        ResourceUsage usage; /* Resources used by the test, benchmark threads included, summed over the runs */
+        MemoryUsage memory; /* Memory used by the test: peaks are the highest of the runs, growths are summed */
+        Counters counters; /* Throughput counters of the last run */
+        std::vector<std::pair<std::string, LatencyHistogram>> latencies; /* Latency histograms by operation, merged over the runs */
+        SourceLocation location; /* Location of the failed assertion of the first failed run, unknown if not captured */
+        long long mismatch = -1; /* Index of the first mismatching element reported by that assertion, -1 if none */
+        std::string diff; /* Diff of the sequences compared by that assertion, empty if none */
+
+        /*
+         * Returns empty details, standing for those of a test not run.
+         *
+         * Return value: The empty details
+         */
+        static const TestDetails& none() {
+          static const TestDetails empty;
+
+          return empty;
+        }
+      };
+
+      /* Test data structure */
+      typedef struct _TestData {
+        TestFunc func; /* Test function, nullptr for generated tests */
+        const char* name; /* Test name, or group name for generated tests */
+        bool passed; /* Test result */
+        double time; /* Test duration in seconds, averaged over the runs */
+        std::uint64_t time_ns; /* Test duration in nanoseconds, averaged over the runs */
+        std::uint64_t tags; /* Test tags, as a bit mask over the tags of the test case */
+        bool selected; /* true if the test was selected by the last run */
+        TestGroup* group; /* Group of the generated test, nullptr for plain tests */
+        size_t index; /* Index of the generated test into its group */
+        std::string message; /* Failure message, of the first failed run */
+        size_t runs; /* Number of runs of the last call to TestCase::run() */
+        size_t failures; /* Number of failed runs */
+        double min_time; /* Shortest run duration in seconds */
+        double median_time; /* Median run duration in seconds */
+        double max_time; /* Longest run duration in seconds */
+        int cpu; /* CPU the last run ended on, -1 if unknown */
+        int node; /* NUMA node of that CPU, -1 if unknown */
+        double first_time; /* Duration of the first run in seconds, warmup included: cold caches and lazy initialization */
+        size_t warmups; /* Number of warmup runs, not part of the statistics */
+        double budget; /* Maximum median run duration in seconds, 0 for none */
+        std::unique_ptr<TestDetails> details; /* Details of the last run, nullptr until a run fills them */
+
+        /*
+         * Returns the details of the last run.
+         *
+         * Return value: The details, empty if the test has not run
+         */
+        const TestDetails& get_details() const { return details? *details: TestDetails::none(); }
+
+        /*
+         * Checks whether the test both passed and failed over its runs.
+         *
+         * Return value: true if the test is flaky, false if not
+         */
+        bool flaky() const { return failures && failures < runs; }
+
+        /*
+         * Returns the fraction of the runs that passed.
+         *
+         * Return value: The pass rate, between 0 and 1
+         */
+        double pass_rate() const { return runs? double(runs - failures) / runs: 0.0; }
+
+        /*
+         * Returns the full test name. The names of generated tests are built on
+         * each call.
+         *
+         * Return value: The test name
+         */
+        std::string full_name() const { return group? group->name(name, index): std::string(name); }
+      } TestData;
+
+      /*
+       * Setup function. Override this function to setup an environment for the test case.
+       */
+      virtual void setup() {}
+
+      /*
+       * Cleanup function. Override this function to cleanup the environment after the test
+       * case completes.
+       */
+      virtual void cleanup() {}
+
+      /*
+       * Schedule a test for running.
+       *
+       * test: The test function
+       * name: The test name
+       * tags: A comma separated list of tags for the test, or nullptr. A test
+       *       case can hold up to 64 distinct tags.
+       */
+      void add(TestFunc test, const char* name, const char* tags = nullptr) { push_test(test, name, intern_tags(tags), nullptr, 0); }
+
+      /*
+       * Schedule a test for running within a time budget. The test fails if
+       * the median duration of its runs exceeds the budget, even if all of
+       * them passed.
+       *
+       * test: The test function
+       * name: The test name
+       * budget: The time budget
+       * tags: A comma separated list of tags for the test, or nullptr
+       */
+      void add(TestFunc test, const char* name, std::chrono::nanoseconds budget, const char* tags = nullptr) {
+        push_test(test, name, intern_tags(tags), nullptr, 0);
+
+        if(!fixture)
+          data.back().budget = 1e-9 * budget.count();
+      }
+
+      /*
+       * Schedule a value-parameterized test for running, once for each parameter.
+       *
+       * The parameters are stored contiguously inside the test group, and each
+       * test is named after the group name and its parameter index, as in
+       * "name/3".
+       *
+       * test: The test function, taking the parameter
+       * name: The test group name
+       * params: The parameters
+       * tags: A comma separated list of tags for the tests, or nullptr
+       *
+       * P: The parameter type
+       */
+      template<typename P> void add(void (T::*test)(const P&), const char* name, std::vector<P> params, const char* tags = nullptr) {
+        add_group(new ParamGroup<P>(test, std::move(params), nullptr), name, tags);
+      }
+
+      /*
+       * Schedule a value-parameterized test for running, once for each parameter,
+       * naming each test through a formatter.
+       *
+       * test: The test function, taking the parameter
+       * name: The test group name
+       * params: The parameters
+       * formatter: A callable returning the name of a test given the group name,
+       *            the parameter and its index. It is only called when the name is needed.
+       * tags: A comma separated list of tags for the tests, or nullptr
+       *
+       * P: The parameter type
+       */
+      template<typename P> void add(void (T::*test)(const P&), const char* name, std::vector<P> params,
+          typename ParamGroup<P>::Formatter formatter, const char* tags = nullptr) {
+        add_group(new ParamGroup<P>(test, std::move(params), formatter), name, tags);
+      }
+
+      /*
+       * Schedule a typed test for running, once for each type.
+       *
+       * Each test is named after the group name and its type, as in "name<int>".
+       *
+       * name: The test group name
+       * tags: A comma separated list of tags for the tests, or nullptr
+       *
+       * Test: The test template. Test<U>::run(T& fixture) is called to run the test for the type U.
+       * Types: The types to run the test for
+       */
+      template<template<typename> class Test, typename... Types> void add_typed(const char* name, const char* tags = nullptr) {
+        add_group(new TypedGroup({ &Test<Types>::run... }, { &typeid(Types)... }), name, tags);
+      }
+
+      /*
+       * Schedule a benchmark for running.
+       *
+       * The benchmark function is called with a growing number of iterations
+       * until the measured time is long enough (see Benchmark). The test fails
+       * if the function fails, and its result records the iterations and the
+       * time of the last call.
+       *
+       * test: The benchmark function
+       * name: The test name
+       * config: The benchmark configuration
+       * tags: A comma separated list of tags for the test, or nullptr
+       */
+      void add_benchmark(void (T::*test)(Benchmark&), const char* name, const BenchmarkConfig& config = BenchmarkConfig(), const char* tags = nullptr) {
+        add_group(new BenchmarkGroup(test, std::vector<std::vector<long long>>(), config), name, tags);
+      }
+
+      /*
+       * Schedule a benchmark for running over ranges of arguments.
+       *
+       * A benchmark instance is generated for each combination of the argument
+       * values, named after the values, such as "name/64/2". The instances read
+       * their arguments through Benchmark::range(). If BenchmarkConfig::complexity
+       * is set, the times of the instances are fitted to a complexity class (see
+       * get_complexity()).
+       *
+       * test: The benchmark function
+       * name: The group name
+       * args: The values of each argument, see range() and geometric_range()
+       * config: The benchmark configuration
+       * tags: A comma separated list of tags for the tests, or nullptr
+       *
+       * A: The argument type, an integral type
+       */
+      template<typename A> void add_benchmark(void (T::*test)(Benchmark&), const char* name, std::initializer_list<std::vector<A>> args, const BenchmarkConfig& config = BenchmarkConfig(), const char* tags = nullptr) {
+        std::vector<std::vector<long long>> values;
+
+        for(typename std::initializer_list<std::vector<A>>::const_iterator it = args.begin(); it != args.end(); it++)
+          values.push_back(std::vector<long long>(it->begin(), it->end()));
+
+        add_group(new BenchmarkGroup(test, std::move(values), config), name, tags);
+      }
+
+      /*
+       * Schedule a fuzz test for running.
+       *
+       * In fuzz mode (see TestCase::set_fuzz_mode()) the test function is driven
+       * by a Fuzzer with inputs mutated from its corpus; when more than one
+       * worker is used, the additional workers run on fixtures drawn from the
+       * fixture pool. Otherwise the test function is run on each corpus entry,
+       * so that the corpus acts as a regression test. In both modes a failing
+       * input fails the test, with the minimized input in the failure message.
+       *
+       * test: The test function, taking the input and its size
+       * name: The test name
+       * config: The fuzzing configuration
+       * tags: A comma separated list of tags for the test, or nullptr
+       */
+      void add_fuzz(void (T::*test)(const std::uint8_t*, size_t), const char* name, const FuzzConfig& config = FuzzConfig(), const char* tags = nullptr) {
+        add_group(new FuzzGroup(this, test, config), name, tags);
+      }
+
+      /*
+       * Sets the fuzz mode.
+       *
+       * fuzz: true to fuzz the fuzz tests, false to replay their corpus
+       */
+      void set_fuzz_mode(bool fuzz) { fuzzing = fuzz; }
+
+      /*
+       * Returns the fuzz mode.
+       *
+       * Return value: true if the fuzz tests are fuzzed, false if their corpus is replayed
+       */
+      bool is_fuzz_mode() const { return fuzzing; }
+
+      /*
+       * Sets the filter used to select the tests to run.
+       *
+       * filter: The test filter
+       */
+      void set_filter(const TestFilter& filter) { this->filter = filter; }
+
+      /*
+       * Returns the filter used to select the tests to run.
+       *
+       * Return value: The test filter
+       */
+      const TestFilter& get_filter() const { return filter; }
+
+      /*
+       * Sets the fixture isolation mode.
+       *
+       * In Isolation::PER_TEST mode each test runs on a fixture drawn from the
+       * fixture pool instead of this object: setup() is called on the fixture
+       * before the test and cleanup() after it, then the fixture goes back to the
+       * pool to be reused by the next test.
+       *
+       * isolation: The isolation mode
+       * pool_size: The number of fixtures to construct before running the tests,
+       *            the others being constructed when first needed
+       */
+      void set_isolation(Isolation isolation, size_t pool_size = 1) {
+        this->isolation = isolation;
+        this->pool_size = pool_size;
+      }
+
+      /*
+       * Returns the fixture isolation mode.
+       *
+       * Return value: The isolation mode
+       */
+      Isolation get_isolation() const { return isolation; }
+
+      /*
+       * Sets the factory used to construct the pooled fixtures. It is only needed
+       * when T is not default constructible.
+       *
+       * factory: The fixture factory
+       */
+      void set_fixture_factory(typename FixturePool<T>::Factory factory) { pool.set_factory(factory); }
+
+      /*
+       * Returns the fixture pool.
+       *
+       * Return value: The fixture pool
+       */
+      FixturePool<T>& get_fixture_pool() { return pool; }
+
+      /*
+       * Sets the number of times each test is run.
+       *
+       * Repeating the tests exposes the flaky ones: the result of a repeated test
+       * records its number of runs and failures and the distribution of its run
+       * durations, and the test fails if any run fails. In Isolation::PER_TEST
+       * mode the runs of a test are spread over the workers (see set_workers()),
+       * each run on its own pooled fixture; otherwise they run one after the
+       * other on this object.
+       *
+       * count: The number of runs of each test, at least 1
+       * until_failure: true to stop repeating a test at its first failure
+       */
+      void set_repeat(size_t count, bool until_failure = false) {
+        this->repeat = count? count: 1;
+        this->until_failure = until_failure;
+      }
+
+      /*
+       * Returns the number of times each test is run.
+       *
+       * Return value: The number of runs of each test
+       */
+      size_t get_repeat() const { return repeat; }
+
+      /*
+       * Sets the number of threads running the repetitions of a test in
+       * Isolation::PER_TEST mode.
+       *
+       * workers: The number of threads, 0 for one per hardware thread
+       */
+      void set_workers(unsigned workers) { this->workers = workers; }
+
+      /*
+       * Returns the number of threads running the repetitions of a test.
+       *
+       * Return value: The number of threads, 0 for one per hardware thread
+       */
+      unsigned get_workers() const { return workers; }
+
+      /*
+       * Sets the number of warmup runs of each test. Warmup runs take place on
+       * a single fixture before the measured runs, and are left out of the
+       * statistics but for the duration of the first one (see
+       * TestData::first_time). A failed warmup run fails the test, which is
+       * not run any further.
+       *
+       * runs: The number of warmup runs
+       */
+      void set_warmup(size_t runs) { warmup = runs; }
+
+      /*
+       * Returns the number of warmup runs of each test.
+       *
+       * Return value: The number of warmup runs
+       */
+      size_t get_warmup() const { return warmup; }
+
+      /*
+       * Sets whether the CPU caches are flushed before each measured run (see
+       * flush_cache()), to measure the tests with cold caches. The flush is
+       * not part of the measurements.
+       *
+       * cold: true to flush the caches before each run
+       */
+      void set_cold_cache(bool cold) { cold_cache = cold; }
+
+      /*
+       * Checks whether the CPU caches are flushed before each measured run.
+       *
+       * Return value: true if the caches are flushed, false if not
+       */
+      bool is_cold_cache() const { return cold_cache; }
+
+      /*
+       * Fits the times of the benchmarks registered with complexity fitting (see
+       * BenchmarkConfig::complexity) to the complexity classes. Only the
+       * instances of the last run are fitted, and the benchmarks with less than
+       * two instances run are left out.
+       *
+       * Return value: The benchmark names and their best fit, in registration order
+       */
+      std::vector<std::pair<std::string, ComplexityFit>> get_complexity() const {
+        std::vector<std::pair<std::string, ComplexityFit>> fits;
+
+        for(size_t g = 0; g < groups.size(); g++) {
+          const BenchmarkGroup* group = dynamic_cast<const BenchmarkGroup*>(groups[g].get());
+          std::vector<std::pair<double, double>> samples;
+
+          if(!group || !group->fits_complexity())
+            continue;
+
+          for(size_t t = group_ranges[g].first; t < group_ranges[g].first + group_ranges[g].second; t++) {
+            const BenchmarkResult& benchmark = tests[t]->get_details().benchmark;
+
+            if(tests[t]->selected && benchmark.iterations)
+              samples.push_back(std::make_pair(double(benchmark.complexity_n), benchmark.time_per_iteration()));
+          }
+
+          if(samples.size() >= 2)
+            fits.push_back(std::make_pair(std::string(tests[group_ranges[g].first]->name), ComplexityFit::fit(samples)));
+        }
+
+        return fits;
+      }
+
+      /* Point of the scaling curve of a multi-threaded benchmark */
+      struct ScalingPoint {
+        std::string name; /* Benchmark instance name, without the number of threads */
+        unsigned threads; /* Number of threads */
+        double rate; /* Iterations per second, over all the threads */
+        double speedup; /* Rate over the rate with the fewest threads */
+        double efficiency; /* Speedup over the increase in threads */
+      };
+
+      /*
+       * Returns the scaling curves of the benchmarks run on more than one number
+       * of threads (see BenchmarkConfig::threads), from the instances of the last
+       * run.
+       *
+       * Return value: The points of the curves, by instance and number of threads
+       */
+      std::vector<ScalingPoint> get_scaling() const {
+        std::vector<ScalingPoint> points;
+
+        for(size_t g = 0; g < groups.size(); g++) {
+          const BenchmarkGroup* group = dynamic_cast<const BenchmarkGroup*>(groups[g].get());
+          size_t counts = group? group->thread_counts(): 0;
+
+          if(counts < 2)
+            continue;
+
+          for(size_t i = 0; i < group_ranges[g].second; i += counts) {
+            size_t first = points.size();
+
+            for(size_t c = 0; c < counts; c++) {
+              const TestData* test = tests[group_ranges[g].first + i + c];
+              const BenchmarkResult& benchmark = test->get_details().benchmark;
+              ScalingPoint point;
+
+              if(!test->selected || !benchmark.iterations || benchmark.time <= 0.0)
+                continue;
+
+              point.name = group->instance_name(test->name, i + c);
+              point.threads = benchmark.threads;
+              point.rate = benchmark.iterations * benchmark.threads / benchmark.time;
+              point.speedup = point.efficiency = 1.0;
+
+              if(points.size() > first) {
+                point.speedup = point.rate / points[first].rate;
+                point.efficiency = point.speedup * points[first].threads / point.threads;
+              }
+
+              points.push_back(point);
+            }
+          }
+        }
+
+        return points;
+      }
+
+      /*
+       * Sets the placement of the threads running the tests.
+       *
+       * With a placement, each worker (see set_workers()) is pinned to a CPU,
+       * filling or alternating the NUMA nodes as read from /sys, and can prefer
+       * the memory of its node for its allocations, such as those of the
+       * fixtures it constructs and sets up. The CPU affinity of the calling
+       * thread is restored at the end of run(). Only supported on Linux.
+       *
+       * placement: The placement
+       * bind_memory: true to bind the allocations of each worker to its node
+       */
+      void set_placement(Placement placement, bool bind_memory = true) {
+        this->placement = placement;
+        this->bind_memory = bind_memory;
+      }
+
+      /*
+       * Returns the placement of the threads running the tests.
+       *
+       * Return value: The placement
+       */
+      Placement get_placement() const { return placement; }
+
+      /*
+       * Sets the snapshot file of the test case, where Assert::assert_snapshot()
+       * keeps the snapshots of the tests. The file is mapped once here, and is
+       * rewritten at the end of run() only if a snapshot was recorded or
+       * updated.
+       *
+       * path: The file path, created on the first recorded snapshot
+       *
+       * Throws std::runtime_error if the file exists but cannot be read or is not a snapshot file.
+       */
+      void set_snapshot_file(const char* path) { snapshots = std::make_shared<SnapshotStore>(path); }
+
+      /*
+       * Returns the snapshot store of the test case.
+       *
+       * Return value: The snapshot store, or nullptr if no snapshot file is set
+       */
+      SnapshotStore* get_snapshots() const { return snapshots.get(); }
+
+      /*
+       * Sets whether the benchmarks may run in a noisy environment.
+       *
+       * Before running the first benchmark, run() reads the state of the
+       * machine once per process (see get_environment()) and the exporters
+       * report it along with its warnings. In strict mode, when there are warnings, the benchmarks are
+       * not run and fail instead, so that no timings are recorded from a noisy
+       * machine. The other tests run as usual.
+       *
+       * strict: true to refuse running the benchmarks in a noisy environment
+       */
+      void set_strict_preflight(bool strict) { strict_preflight = strict; }
+
+      /*
+       * Checks whether the benchmarks are refused in a noisy environment.
+       *
+       * Return value: true in strict mode, false if not
+       */
+      bool is_strict_preflight() const { return strict_preflight; }
+
+      /*
+       * Returns the environment the tests run in, read once per process (see
+       * Environment::get()).
+       *
+       * Return value: The environment
+       */
+      const Environment& get_environment() const { return Environment::get(); }
+
+      /*
+       * Enables or disables the random ordering of the tests.
+       *
+       * When enabled, run() shuffles the selected tests with a seed that is
+       * recorded and exported along with the results, so that the same order
+       * can be replayed by passing the seed back. Tests depending on the side
+       * effects of their predecessors can then be found through bisect().
+       *
+       * shuffle: true to run the tests in random order
+       * seed: The shuffle seed, 0 to draw a new seed on each run (see the ENKI_SEED environment variable)
+       */
+      void set_shuffle(bool shuffle, std::uint64_t seed = 0) {
+        this->shuffle = shuffle;
+        this->shuffle_seed = seed;
+      }
+
+      /*
+       * Checks whether the tests are run in random order.
+       *
+       * Return value: true if the tests are shuffled, false if they run in registration order
+       */
+      bool is_shuffled() const { return shuffle; }
+
+      /*
+       * Returns the seed the tests were shuffled with by the last run.
+       *
+       * Return value: The shuffle seed, 0 if the last run did not shuffle the tests
+       */
+      std::uint64_t get_seed() const { return seed; }
+
+      /*
+       * Returns the tests of the last run, in the order they were run.
+       *
+       * Return value: The tests of the last run
+       */
+      const std::vector<TestData*>& get_schedule() const { return scheduled; }
+
+      /*
+       * Runs the tests and stores the results.
+       *
+       * Only the tests selected by the filter are run. If no test is selected,
+       * neither setup() nor cleanup() are called. The snapshots recorded or
+       * updated by the tests are saved at the end.
+       *
+       * Return value: true if all the tests passed, false if not
+       *
+       * Throws std::runtime_error if the snapshot file cannot be written.
+       */
+      bool run() {
+        bool err = false; /* Did any test fail? */
+        std::vector<TestData*> schedule = select();
+
+        Timer::init();
+        seed = 0;
+
+        if(shuffle) {
+          seed = shuffle_seed? shuffle_seed: detail::random_seed();
+
+          /* Fisher-Yates, with a generator that yields the same order on every platform */
+          for(size_t t = schedule.size(); t > 1; t--)
+            std::swap(schedule[t - 1], schedule[detail::mix_seed(seed, t) % t]);
+
+          scheduled = schedule;
+        }
+
+        if(schedule.empty())
+          return true;
+
+        /*
+         * Touches the flush buffer and reads the environment now rather than
+         * within the measures of the first cold test or benchmark, and before
+         * the threads are placed
+         */
+        for(typename std::vector<TestData*>::iterator it = schedule.begin(); it != schedule.end(); it++) {
+          if(cold_cache || ((*it)->group && (*it)->group->flushes_cache()))
+            detail::FlushBuffer::get();
+
+          if(dynamic_cast<const BenchmarkGroup*>((*it)->group))
+            Environment::get();
+        }
+
+        detail::AffinityGuard affinity(placement != Placement::NONE);
+
+        if(isolation == Isolation::PER_TEST) {
+          /* Further fixtures, such as those of the placed workers, are constructed on demand */
+          pool.reserve(pool_size);
+
+          for(typename std::vector<TestData*>::iterator it = schedule.begin(); it != schedule.end(); it++)
+            if(!run_isolated_test(**it))
+              err = true;
+        } else {
+          detail::place_thread(placement, 0, bind_memory);
+          setup();
+
+          for(typename std::vector<TestData*>::iterator it = schedule.begin(); it != schedule.end(); it++)
+            if(!run_test(**it, static_cast<T*>(this)))
+              err = true;
+
+          cleanup();
+        }
+
+        if(snapshots && !snapshots->save())
+          throw std::runtime_error("enki: cannot write the snapshot file " + snapshots->get_path());
+
+        return !err;
+      }
+
+      /*
+       * Finds the tests a failing test depends on.
+       *
+       * The predecessors of the test in the given order are narrowed down by
+       * delta debugging to a minimal set that still makes the test fail when run
+       * before it. Each trial runs a subset on a new fixture, constructed through
+       * the fixture pool factory and set up once as in a shared run; the trials
+       * of each step run in parallel. Tests whose interference goes through
+       * global state rather than the fixture should be bisected with one worker.
+       *
+       * order: The order the test failed in, such as the schedule of a shuffled run
+       * test: The failing test
+       * workers: The number of trials run at the same time, 0 for one per hardware thread
+       *
+       * Return value: The minimal set of predecessors making the test fail, in
+       *               run order; empty if the test fails on its own
+       */
+      std::vector<TestData*> bisect(const std::vector<TestData*>& order, const TestData& test, unsigned workers = 0) {
+        typename std::vector<TestData*>::const_iterator position = std::find(order.begin(), order.end(), &test);
+        std::vector<TestData*> culprits(order.begin(), position);
+        size_t granularity = 2;
+
+        if(position == order.end())
+          throw std::invalid_argument("enki: the test to bisect is not part of the order");
+
+        if(!reproduces(culprits, test))
+          throw std::runtime_error("enki: the test does not fail after its predecessors");
+
+        if(reproduces(std::vector<TestData*>(), test))
+          return std::vector<TestData*>();
+
+        while(culprits.size() > 1) {
+          size_t parts = std::min(granularity, culprits.size());
+          std::vector<std::vector<TestData*>> candidates;
+          std::vector<char> failed;
+          size_t found;
+
+          /* Subsets first, then their complements */
+          for(size_t p = 0; p < parts; p++)
+            candidates.push_back(std::vector<TestData*>(culprits.begin() + p * culprits.size() / parts, culprits.begin() + (p + 1) * culprits.size() / parts));
+
+          for(size_t p = 0; parts > 2 && p < parts; p++) {
+            candidates.push_back(std::vector<TestData*>(culprits.begin(), culprits.begin() + p * culprits.size() / parts));
+            candidates.back().insert(candidates.back().end(), culprits.begin() + (p + 1) * culprits.size() / parts, culprits.end());
+          }
+
+          failed.resize(candidates.size());
+
+          detail::parallel_for(candidates.size(), workers, [&] (size_t index, unsigned) {
+            failed[index] = reproduces(candidates[index], test);
+          });
+
+          found = std::find(failed.begin(), failed.end(), true) - failed.begin();
+
+          if(found < parts) {
+            culprits.swap(candidates[found]);
+            granularity = 2;
+          } else if(found < candidates.size()) {
+            culprits.swap(candidates[found]);
+            granularity = std::max<size_t>(parts - 1, 2);
+          } else if(parts < culprits.size())
+            granularity = std::min(2 * parts, culprits.size());
+          else
+            break;
+        }
+
+        return culprits;
+      }
+
+      /*
+       * Finds the tests a failing test depends on, in the order of the last run.
+       * See bisect(const std::vector<TestData*>&, const TestData&, unsigned).
+       *
+       * test: The failing test
+       * workers: The number of trials run at the same time, 0 for one per hardware thread
+       *
+       * Return value: The minimal set of predecessors making the test fail
+       */
+      std::vector<TestData*> bisect(const TestData& test, unsigned workers = 0) { return bisect(scheduled, test, workers); }
+
+      /*
+       * Selects the tests to run through the filter and marks them as selected.
+       *
+       * Only the tests selected by the previous call and the newly selected ones
+       * are visited, so selecting a small subset of a large test case is cheap.
+       *
+       * Return value: The selected tests, in registration order
+       */
+      std::vector<TestData*> select() {
+        std::vector<TestData*> schedule;
+
+        if(filter.empty())
+          schedule = tests;
+        else {
+          std::vector<char> marks = filter_includes();
+          std::uint64_t excluded_tags = tag_mask(filter.tags[1]);
+
+          for(size_t t = 0; t < marks.size(); t++) {
+            if(marks[t]) {
+              TestData* test = tests[t];
+
+              if(!(test->tags & excluded_tags) && !matches(filter.globs[1], filter.regexes[1], *test))
+                schedule.push_back(test);
+            }
+          }
+        }
+
+        for(typename std::vector<TestData*>::iterator it = scheduled.begin(); it != scheduled.end(); it++)
+          (*it)->selected = false;
+
+        for(typename std::vector<TestData*>::iterator it = schedule.begin(); it != schedule.end(); it++)
+          (*it)->selected = true;
+
+        scheduled = schedule;
+
+        return schedule;
+      }
+
+      /*
+       * Successfully passes the running test.
+       */
+      void pass() const { throw TestPassedException(); }
+
+      /*
+       * Fails the running test.
+       *
+       * location: The location of the failure, the caller by default
+       */
+      void fail(const SourceLocation& location = SourceLocation::current()) const { throw TestFailedException(Failure(std::string(), location)); }
+
+      /*
+       * Fails the running test with a message.
+       *
+       * message: The failure message
+       * location: The location of the failure, the caller by default
+       */
+      void fail(const std::string& message, const SourceLocation& location = SourceLocation::current()) const { throw TestFailedException(Failure(message, location)); }
+
+      /*
+       * Declares the bytes processed by the running test, to report its byte
+       * rate. Benchmarks use Benchmark::set_bytes_processed() instead.
+       *
+       * bytes: The number of bytes
+       */
+      void set_bytes_processed(double bytes) const {
+        if(detail::BenchmarkState<>::counters)
+          detail::BenchmarkState<>::counters->bytes = bytes;
+      }
+
+      /*
+       * Declares the items processed by the running test, to report its item
+       * rate. Benchmarks use Benchmark::set_items_processed() instead.
+       *
+       * items: The number of items
+       */
+      void set_items_processed(double items) const {
+        if(detail::BenchmarkState<>::counters)
+          detail::BenchmarkState<>::counters->items = items;
+      }
+
+      /*
+       * Sets a user counter of the running test. Benchmarks use
+       * Benchmark::set_counter() instead.
+       *
+       * name: The counter name
+       * value: The counter value
+       * kind: How the value is reported
+       */
+      void set_counter(const std::string& name, double value, CounterKind kind = CounterKind::TOTAL) const {
+        if(detail::BenchmarkState<>::counters)
+          detail::BenchmarkState<>::counters->set(name, value, kind);
+      }
+
+      /*
+       * Returns the latency histogram of an operation of the running test, to
+       * record the latency of each call of the operation into:
+       *
+       *   LatencyHistogram& latency = this->latency("lookup");
+       *
+       *   for(...) {
+       *     Timer::Ticks t1 = Timer::start();
+       *     ...
+       *     latency.record(t1, Timer::stop());
+       *   }
+       *
+       * The histogram can be shared with the threads started by the test. The
+       * histograms of the runs of a test are merged into TestData::latencies.
+       * Benchmarks use Benchmark::latency() instead.
+       *
+       * name: The operation name
+       *
+       * Return value: The histogram
+       */
+      LatencyHistogram& latency(const std::string& name) const { return detail::BenchmarkState<>::latency(name); }
+
+      /*
+       * Returns the test data.
+       *
+       * Return value: The test data
+       */
+      std::list<TestData>& get_data() { return data; }
+
+      /*
+       * Checks whether a test has a tag.
+       *
+       * test: The test data
+       * tag: The tag
+       *
+       * Return value: true if the test has the tag, false if not
+       */
+      bool has_tag(const TestData& test, const char* tag) const {
+        for(size_t t = 0; t < tag_names.size(); t++)
+          if(tag_names[t] == tag)
+            return (test.tags >> t) & 1;
+
+        return false;
+      }
+
+    private:
+      /*
+       * Value-parameterized test group.
+       *
+       * P: The parameter type
+       */
+      template<typename P> class ParamGroup: public TestGroup {
+        public:
+          typedef void (T::*ParamFunc)(const P&); /* Test function type */
+          typedef std::function<std::string(const char*, const P&, size_t)> Formatter; /* Name formatter type */
+
+          ParamGroup(ParamFunc func, std::vector<P>&& params, Formatter formatter): func(func), params(std::move(params)), formatter(formatter) {}
+
+          virtual void invoke(T& fixture, size_t index) { (fixture.*func)(params[index]); }
+
+          virtual std::string name(const char* base, size_t index) const {
+            return formatter? formatter(base, params[index], index): TestGroup::name(base, index);
+          }
+
+          size_t size() const { return params.size(); }
+
+        private:
+          ParamFunc func; /* Test function */
+          std::vector<P> params; /* Parameters */
+          Formatter formatter; /* Name formatter */
+      };
+
+      /*
+       * Typed test group.
+       */
+      class TypedGroup: public TestGroup {
+        public:
+          typedef void (*TypedFunc)(T&); /* Test function type */
+
+          TypedGroup(std::initializer_list<TypedFunc> funcs, std::initializer_list<const std::type_info*> types): funcs(funcs), types(types) {}
+
+          virtual void invoke(T& fixture, size_t index) { funcs[index](fixture); }
+
+          virtual std::string name(const char* base, size_t index) const { return std::string(base) + "<" + detail::type_name(*types[index]) + ">"; }
+
+          size_t size() const { return funcs.size(); }
+
+        private:
+          std::vector<TypedFunc> funcs; /* Test functions, by type */
+          std::vector<const std::type_info*> types; /* Types */
+      };
+
+      /*
+       * Fuzz test group, holding a single test.
+       */
+      class FuzzGroup: public TestGroup {
+        public:
+          typedef void (T::*FuzzFunc)(const std::uint8_t*, size_t); /* Test function type */
+
+          FuzzGroup(TestCase* owner, FuzzFunc func, const FuzzConfig& config): owner(owner), func(func), config(config) {}
+
+          virtual void invoke(T& fixture, size_t) {
+            Fuzzer fuzzer(config);
+            std::vector<T*> fixtures(fuzzer.workers(), &fixture);
+            std::vector<std::unique_ptr<T>> pooled;
+            FuzzFunc f = func;
+            auto target = [&fixtures, f] (unsigned worker, const std::uint8_t* data, size_t size) { (fixtures[worker]->*f)(data, size); };
+            FuzzResult result;
+
+            if(!owner->fuzzing)
+              result = fuzzer.replay(target);
+            else {
+              for(size_t w = 1; w < fixtures.size(); w++) {
+                pooled.push_back(owner->pool.acquire());
+                pooled.back()->setup();
+                fixtures[w] = pooled.back().get();
+              }
+
+              result = fuzzer.fuzz(target);
+
+              for(size_t w = 0; w < pooled.size(); w++) {
+                pooled[w]->cleanup();
+                owner->pool.release(std::move(pooled[w]));
+              }
+            }
+
+            if(result.failed)
+              throw TestFailedException(result.report());
+          }
+
+          virtual std::string name(const char* base, size_t) const { return base; }
+
+          size_t size() const { return 1; }
+
+        private:
+          TestCase* owner; /* Test case owning the group */
+          FuzzFunc func; /* Test function */
+          FuzzConfig config; /* Fuzzing configuration */
+      };
+
+      /*
+       * Benchmark group, holding an instance of the benchmark for each
+       * combination of its arguments.
+       */
+      class BenchmarkGroup: public TestGroup {
+        public:
+          typedef void (T::*BenchmarkFunc)(Benchmark&); /* Test function type */
+
+          BenchmarkGroup(BenchmarkFunc func, std::vector<std::vector<long long>>&& args, const BenchmarkConfig& config): func(func), args(std::move(args)), config(config) {}
+
+          virtual void invoke(T& fixture, size_t index) {
+            BenchmarkFunc f = func;
+            BenchmarkResult result = detail::measure([&fixture, f] (Benchmark& state) { (fixture.*f)(state); }, config, arguments(index), threads(index));
+
+            if(detail::BenchmarkState<>::result)
+              *detail::BenchmarkState<>::result = result;
+          }
+
+          virtual std::string name(const char* base, size_t index) const {
+            std::string name = instance_name(base, index);
+
+            if(!config.threads.empty())
+              name += "/threads:" + std::to_string(threads(index));
+
+            return name;
+          }
+
+          size_t size() const {
+            size_t count = std::max<size_t>(config.threads.size(), 1);
+
+            for(size_t t = 0; t < args.size(); t++)
+              count *= args[t].size();
+
+            return count;
+          }
+
+          /*
+           * Returns the name of an instance, without the number of threads.
+           *
+           * base: The group name
+           * index: The instance index
+           *
+           * Return value: The instance name
+           */
+          std::string instance_name(const char* base, size_t index) const {
+            std::vector<long long> values = arguments(index);
+            std::string name(base);
+
+            for(size_t t = 0; t < values.size(); t++)
+              name += "/" + std::to_string(values[t]);
+
+            return name;
+          }
+
+          /*
+           * Returns the number of thread counts each instance is run with.
+           *
+           * Return value: The number of thread counts, 0 if the instances run on the calling thread
+           */
+          size_t thread_counts() const { return config.threads.size(); }
+
+          /*
+           * Returns the number of threads of an instance.
+           *
+           * index: The instance index
+           *
+           * Return value: The number of threads, 0 if the instance runs on the calling thread
+           */
+          unsigned threads(size_t index) const { return config.threads.empty()? 0: config.threads[index % config.threads.size()]; }
+
+          /*
+           * Checks whether the times of the instances are fitted to a complexity class.
+           *
+           * Return value: true if the times are fitted
+           */
+          bool fits_complexity() const { return config.complexity; }
+
+          virtual bool flushes_cache() const { return config.cold_iterations != 0; }
+
+        private:
+          /*
+           * Returns the arguments of an instance. The number of threads varies the
+           * fastest, then the last argument.
+           *
+           * index: The instance index
+           *
+           * Return value: The arguments
+           */
+          std::vector<long long> arguments(size_t index) const {
+            std::vector<long long> values(args.size());
+
+            index /= std::max<size_t>(config.threads.size(), 1);
+
+            for(size_t t = args.size(); t > 0; t--) {
+              values[t - 1] = args[t - 1][index % args[t - 1].size()];
+              index /= args[t - 1].size();
+            }
+
+            return values;
+          }
+
+          BenchmarkFunc func; /* Test function */
+          std::vector<std::vector<long long>> args; /* Values of each argument */
+          BenchmarkConfig config; /* Benchmark configuration */
+      };
+
+      /*
+       * Registers a test.
+       *
+       * func: The test function, nullptr for generated tests
+       * name: The test name
+       * tags: The tag mask
+       * group: The test group, nullptr for plain tests
+       * index: The test index into the group
+       */
+      void push_test(TestFunc func, const char* name, std::uint64_t tags, TestGroup* group, size_t index) {
+        if(fixture)
+          return;
+
+        data.push_back({
+          func, /* Test function */
+          name, /* Test name */
+          false, /* Test passed? */
+          0.0, /* Test duration */
+          0, /* Test duration in nanoseconds */
+          tags, /* Test tags */
+          false, /* Test selected? */
+          group, /* Test group */
+          index, /* Test index */
+          std::string(), /* Failure message */
+          0, /* Runs */
+          0, /* Failed runs */
+          0.0, /* Shortest run duration */
+          0.0, /* Median run duration */
+          0.0, /* Longest run duration */
+          -1, /* CPU */
+          -1, /* NUMA node */
+          0.0, /* First run duration */
+          0, /* Warmup runs */
+          0.0, /* Time budget */
+          nullptr /* Details */
+        });
+
+        index_test(&data.back());
+      }
+
+      /*
+       * Registers the tests of a group and takes its ownership.
+       *
+       * group: The test group
+       * name: The group name
+       * tags: A comma separated list of tags for the tests, or nullptr
+       *
+       * G: The group type
+       */
+      template<typename G> void add_group(G* group, const char* name, const char* tags) {
+        std::unique_ptr<TestGroup> owned(group);
+
+        if(fixture)
+          return;
+
+        std::uint64_t mask = intern_tags(tags);
+        size_t count = group->size();
+
+        groups.push_back(std::move(owned));
+        group_ranges.push_back(std::make_pair(tests.size(), count));
+
+        for(size_t t = 0; t < count; t++)
+          push_test(nullptr, name, mask, group, t);
+      }
+
+      /* Outcome of a single run of a test */
+      struct Run {
+        bool done = false; /* true if the run took place */
+        bool passed = false; /* Run result */
+        std::uint64_t time = 0; /* Run duration in nanoseconds */
+        Failure failure; /* Failure details */
+        BenchmarkResult benchmark; /* Benchmark result */
+        ResourceUsage usage; /* Resources used by the run */
+        MemoryUsage memory; /* Memory used by the run */
+        Counters counters; /* Throughput counters */
+        int cpu = -1; /* CPU the run ended on */
+        detail::LatencyTable latencies; /* Latency histograms */
+      };
+
+      /*
+       * Runs a test on pooled fixtures, as many times as set by set_repeat(),
+       * and stores its results.
+       *
+       * test: The test data
+       *
+       * Return value: true if all the runs passed, false if not
+       */
+      bool run_isolated_test(TestData& test) {
+        std::vector<Run> runs(repeat);
+        std::atomic<bool> failed(false);
+        Run first;
+
+        if(refuses(test))
+          return refuse(test);
+
+        if(warmup) {
+          std::unique_ptr<T> fixture;
+          bool warm;
+
+          detail::place_thread(placement, 0, bind_memory);
+          fixture = pool.acquire();
+          fixture->setup();
+          warm = warm_up(test, fixture.get(), first);
+          fixture->cleanup();
+          pool.release(std::move(fixture));
+
+          if(!warm)
+            return record(test, std::vector<Run>(1, first), first);
+        }
+
+        detail::parallel_for(repeat, workers, [&] (size_t index, unsigned worker) {
+          if(until_failure && failed)
+            return;
+
+          detail::place_thread(placement, worker, bind_memory);
+
+          std::unique_ptr<T> fixture = pool.acquire();
+
+          fixture->setup();
+
+          if(!run_once(test, fixture.get(), runs[index], cold_cache))
+            failed = true;
+
+          fixture->cleanup();
+
+          pool.release(std::move(fixture));
+        });
+
+        return record(test, runs, first);
+      }
+
+      /*
+       * Runs a test on a fixture, as many times as set by set_repeat(), and
+       * stores its results.
+       *
+       * test: The test data
+       * cls: The fixture to run the test on
+       *
+       * Return value: true if all the runs passed, false if not
+       */
+      bool run_test(TestData& test, T* cls) {
+        std::vector<Run> runs(repeat);
+        Run first;
+
+        if(refuses(test))
+          return refuse(test);
+
+        if(warmup && !warm_up(test, cls, first))
+          return record(test, std::vector<Run>(1, first), first);
+
+        for(size_t r = 0; r < repeat; r++)
+          if(!run_once(test, cls, runs[r], cold_cache) && until_failure)
+            break;
+
+        return record(test, runs, first);
+      }
+
+      /*
+       * Runs a test as many times as set by set_warmup(), stopping at the first
+       * failure.
+       *
+       * test: The test data
+       * cls: The fixture to run the test on
+       * first: Receives the first run, or the failed one
+       *
+       * Return value: true if all the runs passed, false if not
+       */
+      bool warm_up(const TestData& test, T* cls, Run& first) const {
+        for(size_t w = 0; w < warmup; w++) {
+          Run run;
+
+          if(!run_once(test, cls, w? run: first)) {
+            if(w)
+              first = run;
+
+            return false;
+          }
+        }
+
+        return true;
+      }
+
+      /*
+       * Runs a test once on a fixture.
+       *
+       * test: The test data
+       * cls: The fixture to run the test on
+       * run: Receives the outcome of the run
+       * cold: true to flush the caches before the run
+       *
+       * Return value: true if the test passed, false if not
+       */
+      bool run_once(const TestData& test, T* cls, Run& run, bool cold = false) const {
+        Timer::Ticks t1, t2;
+
+        if(cold)
+          flush_cache();
+
+        ResourceUsage usage = ResourceUsage::thread(), workers;
+        detail::MemoryProbe memory;
+
+        detail::BenchmarkState<>::result = &run.benchmark;
+        detail::BenchmarkState<>::counters = &run.counters;
+        detail::BenchmarkState<>::latencies = &run.latencies;
+        detail::BenchmarkState<>::workers = &workers;
+        detail::SnapshotState<>::store = snapshots.get();
+        detail::SnapshotState<>::count = 0;
+
+        if(snapshots)
+          detail::SnapshotState<>::name = test.full_name();
+
+        t1 = Timer::start();
+        run.passed = call_test(test, cls, run.failure);
+        t2 = Timer::stop();
+
+        detail::BenchmarkState<>::result = nullptr;
+        detail::BenchmarkState<>::counters = nullptr;
+        detail::BenchmarkState<>::latencies = nullptr;
+        detail::BenchmarkState<>::workers = nullptr;
+        detail::SnapshotState<>::store = nullptr;
+
+        run.memory = memory.finish();
+        run.usage = ResourceUsage::thread() - usage;
+        run.usage += workers;
+        run.time = Timer::elapsed_ns(t1, t2);
+        run.cpu = detail::current_cpu();
+        run.done = true;
+        run.counters.time = run.benchmark.iterations? run.benchmark.time: run.time * 1e-9;
+        run.counters.iterations = run.benchmark.iterations? run.benchmark.iterations * run.benchmark.threads: 1;
+
+        return run.passed;
+      }
+
+      /*
+       * Checks whether a test must not run because of a noisy environment (see
+       * set_strict_preflight()).
+       *
+       * test: The test data
+       *
+       * Return value: true if the test is a benchmark to refuse, false if not
+       */
+      bool refuses(const TestData& test) const {
+        return strict_preflight && dynamic_cast<const BenchmarkGroup*>(test.group) && !Environment::get().quiet();
+      }
+
+      /*
+       * Records a test as failed, without running it, because of a noisy
+       * environment.
+       *
+       * test: The test data
+       *
+       * Return value: false
+       */
+      bool refuse(TestData& test) const {
+        std::vector<Run> runs(1);
+        std::vector<std::string> warnings = Environment::get().warnings();
+
+        runs[0].done = true;
+        runs[0].failure.message = "Benchmark not run in a noisy environment";
+
+        for(size_t t = 0; t < warnings.size(); t++)
+          runs[0].failure.message += (t? "; ": ": ") + warnings[t];
+
+        return record(test, runs);
+      }
+
+      /*
+       * Stores the outcome of the runs of a test into its data.
+       *
+       * test: The test data
+       * runs: The runs, in order; those not done are ignored
+       * first: The first warmup run, not done without warmup
+       *
+       * Return value: true if all the runs passed, false if not
+       */
+      bool record(TestData& test, const std::vector<Run>& runs, const Run& first = Run()) const {
+        std::vector<std::uint64_t> times;
+        std::uint64_t total = 0;
+        TestDetails details;
+
+        test.failures = 0;
+        test.message.clear();
+        test.cpu = -1;
+
+        /* The RSS is only meaningful for a test running alone on its own fixture */
+        details.memory.approximate = isolation != Isolation::PER_TEST || (repeat > 1 && workers != 1);
+
+        for(typename std::vector<Run>::const_iterator it = runs.begin(); it != runs.end(); it++) {
+          if(!it->done)
+            continue;
+
+          if(!it->passed && !test.failures++) {
+            test.message = it->failure.message;
+            details.location = it->failure.location;
+            details.mismatch = it->failure.mismatch;
+            details.diff = it->failure.diff;
+          }
+
+          times.push_back(it->time);
+          total += it->time;
+          details.benchmark = it->benchmark;
+          details.counters = it->counters;
+          test.cpu = it->cpu;
+          merge_latencies(details, it->latencies);
+          details.usage += it->usage;
+          details.memory.peak_rss = std::max(details.memory.peak_rss, it->memory.peak_rss);
+          details.memory.rss_growth += it->memory.rss_growth;
+          details.memory.peak_allocated = std::max(details.memory.peak_allocated, it->memory.peak_allocated);
+          details.memory.allocated_growth += it->memory.allocated_growth;
+          details.memory.tracked = it->memory.tracked;
+          details.memory.approximate = details.memory.approximate || it->memory.approximate;
+        }
+
+        test.details.reset(times.empty()? nullptr: new TestDetails(std::move(details)));
+        std::sort(times.begin(), times.end());
+
+        test.runs = times.size();
+        test.passed = !test.failures;
+        test.node = test.cpu < 0? -1: detail::Topology::get().node_of(test.cpu);
+        test.warmups = first.done? warmup: 0;
+        test.first_time = first.done? 1e-9 * first.time: runs.empty() || !runs[0].done? 0.0: 1e-9 * runs[0].time;
+        test.time_ns = times.empty()? 0: total / times.size();
+        test.time = times.empty()? 0.0: 1e-9 * total / times.size();
+        test.min_time = times.empty()? 0.0: 1e-9 * times.front();
+        test.max_time = times.empty()? 0.0: 1e-9 * times.back();
+        test.median_time = times.empty()? 0.0: times.size() % 2? 1e-9 * times[times.size() / 2]: 0.5e-9 * (times[times.size() / 2 - 1] + times[times.size() / 2]);
+
+        if(test.passed && test.budget > 0.0 && test.median_time > test.budget) {
+          std::ostringstream os;
+
+          os << "Median duration of " << test.median_time << "s exceeds the budget of " << test.budget << "s";
+          test.message = os.str();
+          test.passed = false;
+        }
+
+        return test.passed;
+      }
+
+      /*
+       * Merges the latency histograms of a run into those of a test.
+       *
+       * details: The test details
+       * latencies: The histograms of the run
+       */
+      static void merge_latencies(TestDetails& details, const detail::LatencyTable& latencies) {
+        std::vector<std::pair<std::string, LatencyHistogram>> histograms = latencies.get_histograms();
+
+        for(size_t h = 0; h < histograms.size(); h++) {
+          size_t t = 0;
+
+          while(t < details.latencies.size() && details.latencies[t].first != histograms[h].first)
+            t++;
+
+          if(t == details.latencies.size())
+            details.latencies.push_back(histograms[h]);
+          else
+            details.latencies[t].second.merge(histograms[h].second);
+        }
+      }
+
+      /*
+       * Calls a test function on a fixture.
+       *
+       * test: The test data
+       * cls: The fixture to run the test on
+       * failure: Receives the failure details, cleared if the test passes
+       *
+       * Return value: true if the test passed, false if not
+       */
+      bool call_test(const TestData& test, T* cls, Failure& failure) const {
+        try {
+          if(test.group)
+            test.group->invoke(*cls, test.index);
+          else
+            (cls->*test.func)();
+        } catch(enki::TestFailedException& e) {
+          failure = e.failure();
+
+          return false;
+        } catch(enki::TestPassedException& e) {
+        }
+
+        failure = Failure();
+
+        return true;
+      }
+
+      /*
+       * Checks whether a test fails when run after a set of tests on a new
+       * fixture.
+       *
+       * predecessors: The tests to run first, whatever their result
+       * test: The test
+       *
+       * Return value: true if the test failed, false if it passed
+       */
+      bool reproduces(const std::vector<TestData*>& predecessors, const TestData& test) const {
+        std::unique_ptr<T> fixture = pool.create();
+        Failure failure;
+        bool passed;
+
+        fixture->setup();
+
+        for(typename std::vector<TestData*>::const_iterator it = predecessors.begin(); it != predecessors.end(); it++)
+          call_test(**it, fixture.get(), failure);
+
+        passed = call_test(test, fixture.get(), failure);
+
+        fixture->cleanup();
+
+        return !passed;
+      }
+
+      /*
+       * Converts a comma separated tag list into a tag mask, registering new tags.
+       *
+       * tags: The tag list, or nullptr
+       *
+       * Return value: The tag mask
+       */
+      std::uint64_t intern_tags(const char* tags) {
+        std::uint64_t mask = 0;
+
+        while(tags && *tags) {
+          size_t len = std::strcspn(tags, ",");
+          std::string tag(tags, len);
+          size_t t = 0;
+
+          while(t < tag_names.size() && tag_names[t] != tag)
+            t++;
+
+          if(t == tag_names.size()) {
+            if(t == 64)
+              throw std::length_error("enki: too many tags in test case");
+
+            tag_names.push_back(tag);
+            tag_index.push_back(std::vector<size_t>());
+          }
+
+          mask |= std::uint64_t(1) << t;
+          tags += tags[len]? len + 1: len;
+        }
+
+        return mask;
+      }
 
       /*
-       * Setup function. Override this function to setup an environment for the test case.
+       * Converts a tag list into a tag mask, ignoring unknown tags.
+       *
+       * tags: The tag list
+       *
+       * Return value: The tag mask
        */
-      virtual void setup() {}
+      std::uint64_t tag_mask(const std::vector<std::string>& tags) const {
+        std::uint64_t mask = 0;
 
-      /*
-       * Cleanup function. Override this function to cleanup the environment after the test
-       * case completes.
-       */
-      virtual void cleanup() {}
+        for(std::vector<std::string>::const_iterator it = tags.begin(); it != tags.end(); it++)
+          for(size_t t = 0; t < tag_names.size(); t++)
+            if(tag_names[t] == *it)
+              mask |= std::uint64_t(1) << t;
+
+        return mask;
+      }
 
       /*
-       * Schedule a test for running.
+       * Adds a newly registered test to the test index.
        *
-       * test: The test function
-       * name: The test name
+       * test: The test data
        */
-      void add(TestFunc test, const char* name) {
-        data.push_back({
-          test, /* Test function */
-          name, /* Test name */
-          false, /* Test passed? */
-          0.0 /* Test duration */
-        });
+      void index_test(TestData* test) {
+        for(size_t t = 0; t < tag_names.size(); t++)
+          if((test->tags >> t) & 1)
+            tag_index[t].push_back(tests.size());
+
+        tests.push_back(test);
       }
 
       /*
-       * Runs the tests and stores the results.
-       *
-       * Return value: true if all the tests passed, false if not
+       * Brings the name index up to date with the registered tests.
        */
-      bool run() {
-        bool err = false; /* Did any test fail? */
-        setup();
+      void update_name_index() {
+        if(name_index.size() == tests.size())
+          return;
 
-        for(typename std::list<TestData>::iterator it = data.begin(); it != data.end(); it++) {
-          try {
-            register TestFunc func = (*it).func;
-            register T* cls = static_cast<T*>(this);
-
-            {
-              using namespace std::chrono;
-              time_point<high_resolution_clock> t1, t2;
-              
-              t1 = high_resolution_clock::now();
-              (cls->*func)();
-              t2 = high_resolution_clock::now();
-
-              (*it).time = duration_cast<duration<float>>(t2 - t1).count();
-            }
-
-            (*it).passed = true;
-          } catch(enki::TestFailedException e) {
-            (*it).passed = false;
-            err = true;
-          } catch(enki::TestPassedException e) {
-            (*it).passed = true;
-          }
-        }
+        name_index.resize(tests.size());
 
-        cleanup();
+        for(size_t t = 0; t < tests.size(); t++)
+          name_index[t] = std::make_pair(tests[t]->name, t);
 
-        return !err;
+        std::sort(name_index.begin(), name_index.end(), [] (const NameEntry& a, const NameEntry& b) { return std::strcmp(a.first, b.first) < 0; });
       }
 
       /*
-       * Successfully passes the running test.
+       * Checks whether a test name matches any of the given glob patterns or
+       * regular expressions.
+       *
+       * globs: The glob patterns
+       * regexes: The regular expressions
+       * name: The test name
+       *
+       * Return value: true if any rule matches, false if not
        */
-      void pass() const { throw TestPassedException(); }
+      static bool matches(const std::vector<std::string>& globs, const std::vector<TestFilter::Matcher>& regexes, const char* name) {
+        for(std::vector<std::string>::const_iterator it = globs.begin(); it != globs.end(); it++)
+          if(TestFilter::glob_match(it->c_str(), name))
+            return true;
+
+        for(std::vector<TestFilter::Matcher>::const_iterator it = regexes.begin(); it != regexes.end(); it++)
+          if((*it)(name))
+            return true;
+
+        return false;
+      }
 
       /*
-       * Fails the running test.
+       * Checks whether a test matches any of the given glob patterns or regular
+       * expressions. Generated tests match by either their group name or their
+       * full name.
+       *
+       * globs: The glob patterns
+       * regexes: The regular expressions
+       * test: The test data
+       *
+       * Return value: true if any rule matches, false if not
        */
-      void fail() const { throw TestFailedException(); }
+      static bool matches(const std::vector<std::string>& globs, const std::vector<TestFilter::Matcher>& regexes, const TestData& test) {
+        return matches(globs, regexes, test.name) || (test.group && matches(globs, regexes, test.full_name().c_str()));
+      }
 
       /*
-       * Returns the test data.
+       * Marks the tests matching the include rules of the filter.
        *
-       * Return value: The test data
+       * Glob patterns are looked up in the name index, so that only the tests
+       * sharing their literal prefix are matched. Included tags are looked up in
+       * the tag index.
+       *
+       * Return value: The include marks, indexed by registration order
        */
-      std::list<TestData>& get_data() { return data; }
-    private:
+      std::vector<char> filter_includes() {
+        const std::vector<std::string>& globs = filter.globs[0];
+        const std::vector<TestFilter::Matcher>& regexes = filter.regexes[0];
+        bool by_name = !globs.empty() || !regexes.empty();
+        bool by_tag = !filter.tags[0].empty();
+        std::uint64_t included_tags = tag_mask(filter.tags[0]);
+        std::vector<char> marks(tests.size(), !by_name && !by_tag);
+
+        if(!regexes.empty()) {
+          for(size_t t = 0; t < tests.size(); t++)
+            marks[t] = matches(globs, regexes, *tests[t]);
+        } else if(by_name) {
+          update_name_index();
+
+          for(std::vector<std::string>::const_iterator it = globs.begin(); it != globs.end(); it++) {
+            const char* pattern = it->c_str();
+            size_t len = TestFilter::glob_prefix_length(pattern);
+            typename std::vector<NameEntry>::iterator first = std::lower_bound(name_index.begin(), name_index.end(), pattern,
+              [len] (const NameEntry& entry, const char* p) { return std::strncmp(entry.first, p, len) < 0; });
+
+            if(!pattern[len])
+              for(; first != name_index.end() && !std::strcmp(first->first, pattern); first++)
+                marks[first->second] = true;
+            else
+              for(; first != name_index.end() && !std::strncmp(first->first, pattern, len); first++)
+                if(!marks[first->second] && (TestFilter::glob_match(pattern + len, first->first + len)
+                    || (tests[first->second]->group && TestFilter::glob_match(pattern, tests[first->second]->full_name().c_str()))))
+                  marks[first->second] = true;
+
+            /* Generated tests whose group name is a proper prefix of the literal prefix */
+            for(std::vector<std::pair<size_t, size_t>>::iterator grp = group_ranges.begin(); grp != group_ranges.end(); grp++) {
+              const char* base = grp->second? tests[grp->first]->name: "";
+              size_t base_len = std::strlen(base);
+
+              if(grp->second && base_len < len && !std::strncmp(pattern, base, base_len))
+                for(size_t t = grp->first; t < grp->first + grp->second; t++)
+                  if(!marks[t] && TestFilter::glob_match(pattern, tests[t]->full_name().c_str()))
+                    marks[t] = true;
+            }
+          }
+        } else if(by_tag) {
+          for(size_t t = 0; t < tag_names.size(); t++)
+            if((included_tags >> t) & 1)
+              for(std::vector<size_t>::iterator it = tag_index[t].begin(); it != tag_index[t].end(); it++)
+                marks[*it] = true;
+        }
+
+        if(by_name && by_tag)
+          for(size_t t = 0; t < marks.size(); t++)
+            if(marks[t] && !(tests[t]->tags & included_tags))
+              marks[t] = false;
+
+        return marks;
+      }
+
+      typedef std::pair<const char*, size_t> NameEntry; /* Name index entry: test name and registration index */
+
       std::list<TestData> data; /* Test data */
+      TestFilter filter; /* Test filter */
+      std::vector<TestData*> tests; /* Tests, in registration order */
+      std::vector<TestData*> scheduled; /* Tests selected by the last call to select() */
+      std::vector<NameEntry> name_index; /* Test names, sorted */
+      std::vector<std::string> tag_names; /* Tag names, indexed by tag bit */
+      std::vector<std::vector<size_t>> tag_index; /* Test indices, by tag bit */
+      std::vector<std::unique_ptr<TestGroup>> groups; /* Test groups */
+      std::vector<std::pair<size_t, size_t>> group_ranges; /* Index of the first test and number of tests, by group */
+      Isolation isolation = Isolation::SHARED; /* Fixture isolation mode */
+      size_t pool_size = 1; /* Number of fixtures to construct before running in isolation */
+      FixturePool<T> pool; /* Fixture pool */
+      bool fixture = detail::FixtureState<T>::constructing; /* true for the fixtures constructed by the pool, which register no test */
+      bool fuzzing = false; /* true to fuzz the fuzz tests, false to replay their corpus */
+      bool shuffle = false; /* true to run the tests in random order */
+      std::uint64_t shuffle_seed = 0; /* Shuffle seed, 0 to draw a new one on each run */
+      std::uint64_t seed = 0; /* Shuffle seed of the last run */
+      size_t repeat = 1; /* Number of runs of each test */
+      bool until_failure = false; /* true to stop repeating a test at its first failure */
+      unsigned workers = 1; /* Number of threads running the repetitions of a test in isolation */
+      Placement placement = Placement::NONE; /* Placement of the threads running the tests */
+      bool bind_memory = true; /* true to bind the allocations of the placed threads to their node */
+      bool strict_preflight = false; /* true to refuse running the benchmarks in a noisy environment */
+      size_t warmup = 0; /* Number of unrecorded runs of each test before the measured ones */
+      bool cold_cache = false; /* true to flush the caches before each measured run */
+      std::shared_ptr<SnapshotStore> snapshots; /* Snapshot store, or nullptr */
   };
   
   /*
@@ -257,16 +7656,18 @@ namespace enki {
        * The general contract for this method is to export all the data of the
        * given test case.
        *
-       * The default implementation exports each result through the
-       * export_result() function.
+       * The default implementation exports the result of each test of the last
+       * run, in run order, through the export_result() function. When nothing
+       * has been scheduled (before the first run or when the filter selected
+       * no test) all the registered tests are exported instead.
        *
        * tcase: The testcase to export the data of
        */
       virtual void export_results(TestCase<T>& tcase) {
-        typedef typename std::list<typename TestCase<T>::TestData>::iterator qiterator;
+        std::vector<typename TestCase<T>::TestData*> tests = exported_tests(tcase);
 
-        for(qiterator it = tcase.get_data().begin(); it != tcase.get_data().end(); it++)
-          export_result(*it);
+        for(size_t t = 0; t < tests.size(); t++)
+          export_result(*tests[t]);
       }
 
       /*
@@ -287,6 +7688,35 @@ namespace enki {
        * Return value: True if the test duration data has to be exported
        */
       bool is_duration_exported() const { return export_test_durations; }
+
+      /*
+       * Returns the name of a tri-state setting of the environment, such as
+       * Environment::boost.
+       *
+       * value: The setting, 1, 0 or -1
+       *
+       * Return value: "on", "off" or "unknown"
+       */
+      static const char* state(int value) { return value < 0? "unknown": value? "on": "off"; }
+
+      /*
+       * Returns the tests to export: those of the last run in run order, or all
+       * the registered tests when nothing has been scheduled.
+       *
+       * tcase: The testcase
+       *
+       * Return value: The tests to export
+       */
+      static std::vector<typename TestCase<T>::TestData*> exported_tests(TestCase<T>& tcase) {
+        typedef typename std::list<typename TestCase<T>::TestData>::iterator diterator;
+        std::vector<typename TestCase<T>::TestData*> tests(tcase.get_schedule());
+
+        if(tests.empty())
+          for(diterator it = tcase.get_data().begin(); it != tcase.get_data().end(); it++)
+            tests.push_back(&*it);
+
+        return tests;
+      }
   };
 
   template<typename T> class StreamResultExporter: public ResultExporter<T> {
@@ -338,12 +7768,16 @@ namespace enki {
        *
        * Where RESULT is the word "passed" or "failed" (case can vary),
        * duration_data is the duration information, and test_name
-       * is the test name.
+       * is the test name. Repeated tests are followed by their run statistics
+       * and, when the duration data is exported, all the tests are followed by
+       * their resource and memory usage. Memory figures prefixed by '~' are
+       * approximate (see MemoryUsage).
        *
        * data: The test data structure to export
        */
       virtual void export_result(typename TestCase<T>::TestData& data) {
         auto& os = this->get_output_stream();
+        const typename TestCase<T>::TestDetails& details = data.get_details();
 
         os << "[" << (data.passed? ENKI_STYLE_PASSED ENKI_STR_PASSED ENKI_STYLE_DEFAULT: ENKI_STYLE_FAILED ENKI_STR_FAILED ENKI_STYLE_DEFAULT) << "] ";
 
@@ -352,7 +7786,199 @@ namespace enki {
           os << data.time << "s ";
         }
 
-        os << data.name << std::endl;
+        os << data.full_name() << std::endl;
+
+        if(details.benchmark.iterations) {
+          os << "    " << details.benchmark.iterations << " iterations";
+
+          if(details.benchmark.threads > 1)
+            os << " on each of " << details.benchmark.threads << " threads";
+
+          os << ", " << details.benchmark.time_per_iteration() * 1e9 << "ns/iteration, first " << details.benchmark.first_time * 1e9 << "ns";
+
+          if(details.benchmark.cold_iterations)
+            os << ", cold " << details.benchmark.cold_time_per_iteration() * 1e9 << "ns/iteration over " << details.benchmark.cold_iterations << " iterations";
+
+          os << std::endl;
+        }
+
+        if(!details.counters.empty())
+          export_counters(details.counters);
+
+        for(size_t t = 0; t < details.latencies.size(); t++) {
+          const LatencyHistogram& h = details.latencies[t].second;
+
+          os << "    latency " << details.latencies[t].first << ": " << h.get_count() << " samples, min/mean/max " << h.get_min() << "/" << h.get_mean()
+            << "/" << h.get_max() << "ns, p50/p90/p99/p99.9 " << h.percentile(50.0) << "/" << h.percentile(90.0) << "/" << h.percentile(99.0)
+            << "/" << h.percentile(99.9) << "ns" << std::endl;
+        }
+
+        if(data.runs > 1) {
+          os << "    " << data.runs - data.failures << "/" << data.runs << " runs passed";
+
+          if(this->is_duration_exported())
+            os << ", min/median/max " << data.min_time << "/" << data.median_time << "/" << data.max_time << "s";
+
+          os << std::endl;
+        }
+
+        if(this->is_duration_exported() && (data.runs > 1 || data.warmups))
+          os << "    first run " << data.first_time << "s, " << data.warmups << " warmup runs" << std::endl;
+
+        if(this->is_duration_exported())
+          os << "    cpu " << details.usage.user_time << "s user, " << details.usage.system_time << "s sys, "
+            << details.usage.voluntary_switches << "/" << details.usage.involuntary_switches << " voluntary/involuntary switches, "
+            << details.usage.minor_faults << "/" << details.usage.major_faults << " minor/major faults, CPU " << data.cpu << " (node " << data.node << ")" << std::endl;
+
+        if(this->is_duration_exported()) {
+          os << "    memory " << (details.memory.approximate? "~": "") << details.memory.peak_rss << " bytes peak RSS, "
+            << (details.memory.approximate? "~": "") << details.memory.rss_growth << " bytes RSS growth";
+
+          if(details.memory.approximate)
+            os << " (approximate)";
+
+          if(details.memory.tracked)
+            os << ", " << (details.memory.approximate? "~": "") << details.memory.peak_allocated << " bytes peak allocated, "
+              << (details.memory.approximate? "~": "") << details.memory.allocated_growth << " bytes not freed";
+
+          os << std::endl;
+        }
+
+        if(!data.passed && !data.message.empty())
+          export_message(data.message);
+
+        if(!data.passed && details.location.known())
+          os << "    at " << details.location.str() << (details.location.function? std::string(" in ") + details.location.function: std::string()) << std::endl;
+
+        if(!data.passed && !details.diff.empty())
+          export_message(details.diff);
+      }
+
+      /*
+       * Exports the results, preceded by the shuffle seed if the tests ran in
+       * random order and followed by the list of the flaky tests, if any.
+       *
+       * tcase: The testcase to export the data of
+       */
+      virtual void export_results(TestCase<T>& tcase) {
+        typedef typename std::vector<typename TestCase<T>::TestData*>::const_iterator qiterator;
+        auto& os = this->get_output_stream();
+        bool flaky = false;
+
+        if(tcase.get_seed())
+          os << "Shuffle seed: " << tcase.get_seed() << std::endl;
+
+        if(this->is_duration_exported()) {
+          const Environment& env = tcase.get_environment();
+          std::vector<std::string> warnings = env.warnings();
+
+          os << "Environment: " << env.cpus << " CPUs on " << env.nodes << " nodes, " << (env.model.empty()? "unknown model": env.model)
+            << ", governor " << (env.governors.empty()? "unknown": env.governors) << ", boost " << this->state(env.boost) << ", SMT " << this->state(env.smt)
+            << ", load " << env.load << ", " << env.running << " running, isolated CPUs " << (env.isolated.empty()? "none": env.isolated) << ", " << env.compiler << std::endl;
+
+          for(size_t t = 0; t < warnings.size(); t++)
+            os << "Warning: " << warnings[t] << std::endl;
+        }
+
+        StreamResultExporter<T>::export_results(tcase);
+
+        for(qiterator it = tcase.get_schedule().begin(); it != tcase.get_schedule().end(); it++) {
+          if((*it)->flaky()) {
+            if(!flaky)
+              os << "Flaky tests:" << std::endl;
+
+            os << "    " << (*it)->full_name() << ": " << 100.0 * (*it)->pass_rate() << "% of " << (*it)->runs << " runs passed" << std::endl;
+            flaky = true;
+          }
+        }
+
+        std::vector<std::pair<std::string, ComplexityFit>> fits = tcase.get_complexity();
+
+        if(!fits.empty())
+          os << "Complexity:" << std::endl;
+
+        for(size_t t = 0; t < fits.size(); t++)
+          os << "    " << fits[t].first << ": " << ComplexityFit::name(fits[t].second.complexity) << ", coefficient " << fits[t].second.coefficient
+            << "s, RMS " << 100.0 * fits[t].second.rms << "%" << std::endl;
+
+        std::vector<typename TestCase<T>::ScalingPoint> points = tcase.get_scaling();
+
+        if(!points.empty())
+          os << "Scaling:" << std::endl;
+
+        for(size_t t = 0; t < points.size(); t++)
+          os << "    " << points[t].name << " on " << points[t].threads << " threads: " << format_rate(points[t].rate, " iterations/s")
+            << ", speedup " << points[t].speedup << ", efficiency " << 100.0 * points[t].efficiency << "%" << std::endl;
+      }
+
+    protected:
+      /*
+       * Exports the throughput counters of a test on a single line.
+       *
+       * counters: The counters
+       */
+      void export_counters(const Counters& counters) {
+        auto& os = this->get_output_stream();
+        const char* separator = "    ";
+
+        if(counters.bytes != 0.0) {
+          os << separator << format_rate(counters.bytes_per_second(), "B/s");
+          separator = ", ";
+        }
+
+        if(counters.items != 0.0) {
+          os << separator << format_rate(counters.items_per_second(), " items/s");
+          separator = ", ";
+        }
+
+        for(size_t t = 0; t < counters.user.size(); t++) {
+          os << separator << counters.user[t].first << "=" << format_rate(counters.value(t), counters.user[t].second.second == CounterKind::RATE? "/s": "");
+          separator = ", ";
+        }
+
+        os << std::endl;
+      }
+
+      /*
+       * Formats a value with a decimal SI prefix, such as "1.5 G".
+       *
+       * value: The value
+       * unit: The unit appended to the prefix
+       *
+       * Return value: The formatted value
+       */
+      static std::string format_rate(double value, const char* unit) {
+        static const char* prefixes[] = { "", "k", "M", "G", "T", "P" };
+        std::ostringstream os;
+        size_t p = 0;
+
+        while(std::fabs(value) >= 1000.0 && p < 5) {
+          value /= 1000.0;
+          p++;
+        }
+
+        os << value << (*unit == '/' && !p? "": " ") << prefixes[p] << unit;
+
+        return os.str();
+      }
+
+      /*
+       * Exports a multi-line message, indenting each line.
+       *
+       * message: The message
+       */
+      void export_message(const std::string& message) {
+        auto& os = this->get_output_stream();
+
+        for(size_t begin = 0; begin < message.size(); ) {
+          size_t end = message.find('\n', begin);
+
+          if(end == std::string::npos)
+            end = message.size();
+
+          os << "    " << message.substr(begin, end - begin) << std::endl;
+          begin = end + 1;
+        }
       }
   };
  
@@ -420,13 +8046,92 @@ namespace enki {
        */
       virtual void export_result(typename TestCase<T>::TestData& data) {
         auto& os = this->get_output_stream();
+        const typename TestCase<T>::TestDetails& details = data.get_details();
 
         os << "\t\t<test result=\"" << (data.passed? "passed": "failed") << "\"";
 
         if(this->is_duration_exported())
-          os << " duration=\"" << data.time << "\"";
+          os << " duration=\"" << data.time << "\" user-time=\"" << details.usage.user_time << "\" system-time=\"" << details.usage.system_time
+            << "\" voluntary-switches=\"" << details.usage.voluntary_switches << "\" involuntary-switches=\"" << details.usage.involuntary_switches
+            << "\" minor-faults=\"" << details.usage.minor_faults << "\" major-faults=\"" << details.usage.major_faults << "\" cpu=\"" << data.cpu
+            << "\" node=\"" << data.node << "\" first-duration=\"" << data.first_time << "\" warmups=\"" << data.warmups << "\"";
+
+        if(this->is_duration_exported() && data.budget > 0.0)
+          os << " budget=\"" << data.budget << "\"";
+
+        if(this->is_duration_exported()) {
+          os << " peak-rss=\"" << details.memory.peak_rss << "\" rss-growth=\"" << details.memory.rss_growth << "\" rss-approximate=\"" << (details.memory.approximate? "true": "false") << "\"";
+
+          if(details.memory.tracked)
+            os << " peak-allocated=\"" << details.memory.peak_allocated << "\" allocated-growth=\"" << details.memory.allocated_growth
+              << "\" allocated-approximate=\"" << (details.memory.approximate? "true": "false") << "\"";
+        }
+
+        if(data.runs > 1) {
+          os << " runs=\"" << data.runs << "\" failures=\"" << data.failures << "\"";
+
+          if(data.flaky())
+            os << " flaky=\"true\"";
+
+          if(this->is_duration_exported())
+            os << " min-duration=\"" << data.min_time << "\" median-duration=\"" << data.median_time << "\" max-duration=\"" << data.max_time << "\"";
+        }
+
+        if(details.benchmark.iterations)
+          os << " iterations=\"" << details.benchmark.iterations << "\" threads=\"" << details.benchmark.threads << "\" time-per-iteration=\"" << details.benchmark.time_per_iteration() << "\"";
+
+        if(details.benchmark.iterations)
+          os << " first-iteration-time=\"" << details.benchmark.first_time << "\"";
+
+        if(details.benchmark.cold_iterations)
+          os << " cold-iterations=\"" << details.benchmark.cold_iterations << "\" cold-time-per-iteration=\"" << details.benchmark.cold_time_per_iteration() << "\"";
+
+        if(details.counters.bytes != 0.0)
+          os << " bytes-per-second=\"" << details.counters.bytes_per_second() << "\"";
+
+        if(details.counters.items != 0.0)
+          os << " items-per-second=\"" << details.counters.items_per_second() << "\"";
+
+        os << " name=\"" << escape(data.full_name()) << "\"";
+
+        if(data.message.empty() && !details.location.known() && details.diff.empty() && details.counters.user.empty() && details.latencies.empty()) {
+          os << "/>" << std::endl;
+          return;
+        }
+
+        os << ">\n";
 
-        os << " name=\"" << data.name << "\"/>" << std::endl;
+        for(size_t t = 0; t < details.counters.user.size(); t++)
+          os << "\t\t\t<counter name=\"" << escape(details.counters.user[t].first) << "\" kind=\"" << counter_kind(details.counters.user[t].second.second)
+            << "\" value=\"" << details.counters.value(t) << "\"/>\n";
+
+        for(size_t t = 0; t < details.latencies.size(); t++) {
+          const LatencyHistogram& h = details.latencies[t].second;
+
+          os << "\t\t\t<latency name=\"" << escape(details.latencies[t].first) << "\" count=\"" << h.get_count() << "\" min=\"" << h.get_min()
+            << "\" mean=\"" << h.get_mean() << "\" p50=\"" << h.percentile(50.0) << "\" p90=\"" << h.percentile(90.0) << "\" p99=\"" << h.percentile(99.0)
+            << "\" p999=\"" << h.percentile(99.9) << "\" max=\"" << h.get_max() << "\"/>\n";
+        }
+
+        if(!data.message.empty() || details.location.known()) {
+          os << "\t\t\t<message";
+
+          if(details.location.known())
+            os << " file=\"" << escape(details.location.file) << "\" line=\"" << details.location.line << "\"";
+
+          if(details.location.function)
+            os << " function=\"" << escape(details.location.function) << "\"";
+
+          if(details.mismatch >= 0)
+            os << " mismatch=\"" << details.mismatch << "\"";
+
+          os << ">" << escape(data.message) << "</message>\n";
+        }
+
+        if(!details.diff.empty())
+          os << "\t\t\t<diff>" << escape(details.diff) << "</diff>\n";
+
+        os << "\t\t</test>" << std::endl;
       }
 
       /*
@@ -435,19 +8140,107 @@ namespace enki {
        * tcase: The testcase to export the data of
        */
       virtual void export_results(TestCase<T>& tcase) {
-        typedef typename std::list<typename TestCase<T>::TestData>::iterator qiterator;
+        typedef typename std::vector<typename TestCase<T>::TestData*>::const_iterator qiterator;
         auto& os = this->get_output_stream();
 
         /* Testcase header */
-        os << "\t<test-case>\n";
+        os << "\t<test-case";
+
+        if(tcase.get_seed())
+          os << " seed=\"" << tcase.get_seed() << "\"";
+
+        os << ">\n";
+
+        /* Environment */
+        if(this->is_duration_exported()) {
+          const Environment& env = tcase.get_environment();
+          std::vector<std::string> warnings = env.warnings();
+
+          os << "\t\t<environment cpus=\"" << env.cpus << "\" nodes=\"" << env.nodes << "\" model=\"" << escape(env.model) << "\" governors=\""
+            << escape(env.governors) << "\" boost=\"" << this->state(env.boost) << "\" smt=\"" << this->state(env.smt) << "\" busy-siblings=\"" << env.busy_siblings << "\" load=\"" << env.load << "\" running=\"" << env.running
+            << "\" isolated=\"" << escape(env.isolated) << "\" compiler=\"" << escape(env.compiler) << "\" quiet=\"" << (warnings.empty()? "true": "false") << "\"";
+
+          if(warnings.empty())
+            os << "/>\n";
+          else {
+            os << ">\n";
+
+            for(size_t t = 0; t < warnings.size(); t++)
+              os << "\t\t\t<warning>" << escape(warnings[t]) << "</warning>\n";
+
+            os << "\t\t</environment>\n";
+          }
+        }
 
         /* Data */
-        for(qiterator it = tcase.get_data().begin(); it != tcase.get_data().end(); it++)
-          this->export_result(*it);
+        std::vector<typename TestCase<T>::TestData*> tests = this->exported_tests(tcase);
+
+        for(size_t t = 0; t < tests.size(); t++)
+          this->export_result(*tests[t]);
+
+        /* Flakiness report */
+        for(qiterator it = tcase.get_schedule().begin(); it != tcase.get_schedule().end(); it++)
+          if((*it)->flaky())
+            os << "\t\t<flaky-test name=\"" << escape((*it)->full_name()) << "\" pass-rate=\"" << (*it)->pass_rate() << "\"/>\n";
+
+        /* Complexity fits */
+        std::vector<std::pair<std::string, ComplexityFit>> fits = tcase.get_complexity();
+
+        for(size_t t = 0; t < fits.size(); t++)
+          os << "\t\t<complexity name=\"" << escape(fits[t].first) << "\" class=\"" << escape(ComplexityFit::name(fits[t].second.complexity))
+            << "\" coefficient=\"" << fits[t].second.coefficient << "\" rms=\"" << fits[t].second.rms << "\"/>\n";
+
+        /* Scaling curves */
+        std::vector<typename TestCase<T>::ScalingPoint> points = tcase.get_scaling();
+
+        for(size_t t = 0; t < points.size(); t++)
+          os << "\t\t<scaling name=\"" << escape(points[t].name) << "\" threads=\"" << points[t].threads << "\" rate=\"" << points[t].rate
+            << "\" speedup=\"" << points[t].speedup << "\" efficiency=\"" << points[t].efficiency << "\"/>\n";
 
         /* Testcase footer */
         os << "\t</test-case>\n";
       }
+
+    protected:
+      /*
+       * Returns the name of a counter kind.
+       *
+       * kind: The counter kind
+       *
+       * Return value: The kind name
+       */
+      static const char* counter_kind(CounterKind kind) {
+        switch(kind) {
+          case CounterKind::RATE: return "rate";
+          case CounterKind::AVERAGE: return "average";
+          default: return "total";
+        }
+      }
+
+      /*
+       * Escapes the XML special characters of a string.
+       *
+       * str: The string
+       *
+       * Return value: The escaped string
+       */
+      static std::string escape(const std::string& str) {
+        std::string out;
+
+        out.reserve(str.size());
+
+        for(std::string::const_iterator it = str.begin(); it != str.end(); it++)
+          switch(*it) {
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '&': out += "&amp;"; break;
+            case '"': out += "&quot;"; break;
+            case '\'': out += "&apos;"; break;
+            default: out += *it;
+          }
+
+        return out;
+      }
   };
 
   /*
@@ -476,7 +8269,7 @@ namespace enki {
     /*
      * See ResultExporter::export_results()
      */
-    virtual void export_results(TestCase<T> tcase) {
+    virtual void export_results(TestCase<T>& tcase) {
       exp->export_results(tcase);
     }
 
@@ -496,4 +8289,108 @@ namespace enki {
   };
 }
 
+#if defined(ENKI_FUZZ_COVERAGE) && defined(__GNUC__)
+/*
+ * Sanitizer coverage callbacks feeding enki::Fuzzer. They are weak so that the
+ * header can be included by more than one translation unit.
+ */
+extern "C" {
+  ENKI_NO_COVERAGE __attribute__((weak)) void __sanitizer_cov_trace_pc_guard_init(std::uint32_t* start, std::uint32_t* stop) {
+    if(start == stop || *start)
+      return;
+
+    for(std::uint32_t* guard = start; guard < stop; guard++)
+      *guard = ++enki::detail::CoverageState<>::guards;
+  }
+
+  ENKI_NO_COVERAGE __attribute__((weak)) void __sanitizer_cov_trace_pc_guard(std::uint32_t* guard) {
+    if(enki::detail::CoverageState<>::map && *guard)
+      enki::detail::CoverageState<>::hit(*guard);
+  }
+
+  ENKI_NO_COVERAGE __attribute__((weak)) void __sanitizer_cov_trace_pc() {
+    if(enki::detail::CoverageState<>::map) {
+      std::uintptr_t pc = reinterpret_cast<std::uintptr_t>(__builtin_return_address(0));
+
+      enki::detail::CoverageState<>::hit(static_cast<std::uint32_t>(pc ^ (pc >> 15)));
+    }
+  }
+}
+#endif /* ENKI_FUZZ_COVERAGE && __GNUC__ */
+
+#if defined(ENKI_TRACK_ALLOCATIONS) && defined(__GNUC__)
+/*
+ * Allocation tracker feeding enki::MemoryUsage. The replacement operators are
+ * weak so that the header can be included by more than one translation unit;
+ * each block is prefixed with its size, so that deallocation can account for it.
+ */
+namespace enki {
+  namespace detail {
+    template<typename D = void> struct AllocationTracker {
+      static constexpr size_t header = 16; /* Block prefix size, keeping the alignment of malloc() */
+
+      static void* allocate(size_t size) {
+        void* block = std::malloc(size + header);
+
+        if(!block)
+          return nullptr;
+
+        *static_cast<size_t*>(block) = size;
+
+        long long current = AllocationState<>::current.fetch_add(size, std::memory_order_relaxed) + size;
+        long long peak = AllocationState<>::peak.load(std::memory_order_relaxed);
+
+        while(current > peak && !AllocationState<>::peak.compare_exchange_weak(peak, current, std::memory_order_relaxed));
+
+        return static_cast<char*>(block) + header;
+      }
+
+      static void deallocate(void* ptr) {
+        if(!ptr)
+          return;
+
+        void* block = static_cast<char*>(ptr) - header;
+
+        AllocationState<>::current.fetch_sub(*static_cast<size_t*>(block), std::memory_order_relaxed);
+        std::free(block);
+      }
+    };
+
+    static const bool allocation_tracker __attribute__((unused)) = (AllocationState<>::tracking = true);
+  }
+}
+
+/* As the standard ones, the operators call the new handler until the allocation succeeds or there is no handler */
+__attribute__((weak)) void* operator new(size_t size) {
+  for(;;) {
+    void* ptr = enki::detail::AllocationTracker<>::allocate(size);
+    std::new_handler handler;
+
+    if(ptr)
+      return ptr;
+
+    if(!(handler = std::get_new_handler()))
+      throw std::bad_alloc();
+
+    handler();
+  }
+}
+
+__attribute__((weak)) void* operator new[](size_t size) { return operator new(size); }
+
+__attribute__((weak)) void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  try {
+    return operator new(size);
+  } catch(std::bad_alloc&) {
+    return nullptr;
+  }
+}
+
+__attribute__((weak)) void* operator new[](size_t size, const std::nothrow_t&) noexcept { return operator new(size, std::nothrow); }
+__attribute__((weak)) void operator delete(void* ptr) noexcept { enki::detail::AllocationTracker<>::deallocate(ptr); }
+__attribute__((weak)) void operator delete[](void* ptr) noexcept { enki::detail::AllocationTracker<>::deallocate(ptr); }
+__attribute__((weak)) void operator delete(void* ptr, const std::nothrow_t&) noexcept { enki::detail::AllocationTracker<>::deallocate(ptr); }
+__attribute__((weak)) void operator delete[](void* ptr, const std::nothrow_t&) noexcept { enki::detail::AllocationTracker<>::deallocate(ptr); }
+#endif /* ENKI_TRACK_ALLOCATIONS && __GNUC__ */
+
 #endif /* _ENKI_TESTCASE_H */